@@ -0,0 +1,183 @@
+/* Compares Box2D's dynamic AABB tree with SpatialGrid for the queries
+ * BROADPHASE=grid serves: many same-size bodies that all move every step,
+ * some spawned and destroyed each step, and a batch of small region queries.
+ * The tree is updated proxy by proxy as b2World does; the grid is rebuilt.
+ *
+ * Usage: broadphase [frames] [queries per frame] */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <Box2D/Collision/b2DynamicTree.h>
+#include "utility/SpatialGrid.h"
+#include "utility/utility.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double millis(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Body
+{
+    b2Vec2 position, velocity;
+    float radius;
+    int32 proxy;
+};
+
+b2AABB bounds(const Body& body)
+{
+    b2AABB box;
+    box.lowerBound = body.position - b2Vec2(body.radius, body.radius);
+    box.upperBound = body.position + b2Vec2(body.radius, body.radius);
+    return box;
+}
+
+struct Counter
+{
+    bool QueryCallback(int32) { ++hits; return true; }
+    long hits = 0;
+};
+
+struct Result
+{
+    double update = 0, query = 0;
+    long hits = 0;
+};
+
+/* Bodies are spread at a fixed density, about a third of the area covered, and
+ * random walk; one percent are replaced every frame. Both sides see the same
+ * sequence of positions and queries */
+class Scene
+{
+public:
+    Scene(int count, unsigned seed) : rng(seed), side(std::sqrt(count * 12.f) * conf::circle_radius)
+    {
+        for(int i = 0; i != count; ++i)
+            bodies.push_back(spawn());
+    }
+
+    void step()
+    {
+        std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+        for(Body& body : bodies) {
+            body.velocity += b2Vec2(jitter(rng), jitter(rng));
+            body.position += (1 / 60.f) * body.velocity;
+        }
+    }
+
+    Body spawn()
+    {
+        std::uniform_real_distribution<float> place(0, side);
+        float radius = (rng() % 2) ? conf::circle_radius : conf::box_halfwidth * 1.42f;
+        return Body{b2Vec2(place(rng), place(rng)), b2Vec2(0, 0), radius, b2_nullNode};
+    }
+
+    b2AABB query()
+    {
+        std::uniform_real_distribution<float> place(0, side);
+        b2Vec2 center(place(rng), place(rng));
+        float extent = conf::circle_radius * 4;
+        b2AABB box;
+        box.lowerBound = center - b2Vec2(extent, extent);
+        box.upperBound = center + b2Vec2(extent, extent);
+        return box;
+    }
+
+    std::mt19937 rng;
+    float side;
+    std::vector<Body> bodies;
+};
+
+Result runTree(int count, int frames, int queries)
+{
+    Scene scene(count, 1);
+    b2DynamicTree tree;
+    for(Body& body : scene.bodies)
+        body.proxy = tree.CreateProxy(bounds(body), nullptr);
+
+    Result result;
+    Counter counter;
+    for(int frame = 0; frame != frames; ++frame) {
+        Clock::time_point start = Clock::now();
+        scene.step();
+        for(Body& body : scene.bodies)
+            tree.MoveProxy(body.proxy, bounds(body), (1 / 60.f) * body.velocity);
+        for(int i = 0; i != count / 100; ++i) {
+            Body& body = scene.bodies[scene.rng() % count];
+            tree.DestroyProxy(body.proxy);
+            body = scene.spawn();
+            body.proxy = tree.CreateProxy(bounds(body), nullptr);
+        }
+        result.update += millis(start);
+
+        start = Clock::now();
+        for(int i = 0; i != queries; ++i)
+            tree.Query(&counter, scene.query());
+        result.query += millis(start);
+    }
+    result.hits = counter.hits;
+    return result;
+}
+
+Result runGrid(int count, int frames, int queries)
+{
+    Scene scene(count, 1);
+    SpatialGrid grid;
+
+    Result result;
+    for(int frame = 0; frame != frames; ++frame) {
+        Clock::time_point start = Clock::now();
+        scene.step();
+        for(int i = 0; i != count / 100; ++i)
+            scene.bodies[scene.rng() % count] = scene.spawn();
+        grid.clear();
+        for(std::size_t i = 0; i != scene.bodies.size(); ++i) {
+            const Body& body = scene.bodies[i];
+            grid.add(body.position.x, body.position.y, body.radius, i);
+        }
+        grid.build();
+        result.update += millis(start);
+
+        start = Clock::now();
+        for(int i = 0; i != queries; ++i) {
+            b2AABB box = scene.query();
+            grid.query(box.lowerBound.x, box.lowerBound.y, box.upperBound.x, box.upperBound.y,
+                       [&](std::uint32_t) { ++result.hits; });
+        }
+        result.query += millis(start);
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    int frames  = (argc > 1) ? std::atoi(argv[1]) : 120;
+    int queries = (argc > 2) ? std::atoi(argv[2]) : 1000;
+    if(frames <= 0 || queries < 0) {
+        std::fprintf(stderr, "Usage: %s [frames] [queries per frame]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    //The tree's queries test fattened proxies, so its hit counts run a little higher
+    std::printf("%8s  %-5s %12s %12s %12s\n", "bodies", "mode", "update ms", "query ms", "hits/query");
+    for(int count : {10000, 25000, 50000, 100000}) {
+        Result tree = runTree(count, frames, queries);
+        Result grid = runGrid(count, frames, queries);
+        double total = double(frames) * std::max(queries, 1);
+        std::printf("%8d  %-5s %12.3f %12.3f %12.2f\n", count, "tree",
+                    tree.update / frames, tree.query / frames, tree.hits / total);
+        std::printf("%8d  %-5s %12.3f %12.3f %12.2f\n", count, "grid",
+                    grid.update / frames, grid.query / frames, grid.hits / total);
+    }
+    return EXIT_SUCCESS;
+}
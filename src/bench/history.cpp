@@ -0,0 +1,198 @@
+/* Round trip check for WorldHistory, the rewind buffer. Boxes and balls fall
+ * onto a floor and tumble while every step is recorded, along with the exact
+ * state of each body. Restoring a recorded frame must put every body back
+ * within half a precision step of its state then. More bodies are dropped
+ * halfway, which starts a new segment, and truncating to a frame before that
+ * must report exactly those as gone. One body is thrown far past the range of
+ * the quantizer and back, so the deltas have to span both ends of it.
+ *
+ * Usage: history [bodies] [frames] */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <Box2D/Box2D.h>
+#include <entityx/entityx.h>
+#include "sdl2d3/components.h"
+#include "sdl2d3/history.h"
+#include "utility/utility.h"
+
+namespace {
+
+const WorldHistory::Precision precision{0.001f, 0.001f, 0.01f};
+const float dt = 1 / 60.f;
+
+//The quantizer's range in units of the precision; see quantizeValue in history.cpp
+const double quantizeLimit = (1 << 30) - 1;
+
+struct Sample
+{
+    b2Vec2 position;
+    float angle;
+    b2Vec2 velocity;
+    float spin;
+};
+
+Sample sample(const b2Body* body)
+{
+    return Sample{body->GetPosition(), body->GetAngle(), body->GetLinearVelocity(), body->GetAngularVelocity()};
+}
+
+//What a value should read back as: rounded to the precision, within the quantizer's range
+double expected(float value, float step)
+{
+    return std::max(-quantizeLimit, std::min(quantizeLimit, double(value) / step)) * step;
+}
+
+//Within half a step of what was recorded, plus float rounding of the value itself
+bool matches(float restored, float recorded, float step)
+{
+    double want = expected(recorded, step);
+    return std::abs(restored - want) <= 0.5 * step + 2 * FLT_EPSILON * std::abs(want);
+}
+
+bool anglesMatch(float restored, float recorded)
+{
+    //Angles come back wrapped to [-pi, pi)
+    double want = expected(recorded - 2 * b2_pi * std::floor((recorded + b2_pi) / (2 * b2_pi)), precision.angle);
+    double difference = restored - want;
+    difference -= 2 * b2_pi * std::round(difference / (2 * b2_pi));
+    return std::abs(difference) <= 0.5 * precision.angle + 4 * FLT_EPSILON;
+}
+
+ex::Entity drop(b2World& world, ex::EntityManager& entities, float x, float y, bool box)
+{
+    b2BodyDef def;
+    def.type = b2_dynamicBody;
+    def.position.Set(x, y);
+    def.angle = x;      //Some start well past pi, to check the wrap
+    b2Body* body = world.CreateBody(&def);
+    if(box) {
+        b2PolygonShape shape;
+        shape.SetAsBox(conf::box_halfwidth, conf::box_halfwidth);
+        body->CreateFixture(&shape, 1);
+    } else {
+        b2CircleShape shape;
+        shape.m_radius = conf::circle_radius;
+        body->CreateFixture(&shape, 1);
+    }
+    ex::Entity e = entities.create();
+    e.assign<Box2DComponent>(body);
+    setBodyEntity(body, e.id());
+    return e;
+}
+
+void dropRows(b2World& world, ex::EntityManager& entities, std::vector<ex::Entity>& all, int count)
+{
+    for(int i = 0; i != count; ++i)
+        all.push_back(drop(world, entities, (i % 20) * 4.5f - 45, -2 - (i / 20) * 4.5f, i % 2));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    int count  = (argc > 1) ? std::atoi(argv[1]) : 500;
+    int frames = (argc > 2) ? std::atoi(argv[2]) : 600;
+    if(count <= 0 || frames < 8) {
+        std::fprintf(stderr, "Usage: %s [bodies] [frames, at least 8]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    b2World world(b2Vec2(0, 10));
+    b2BodyDef groundDef;
+    groundDef.position.Set(0, 20);
+    b2PolygonShape groundShape;
+    groundShape.SetAsBox(60, 1);
+    world.CreateBody(&groundDef)->CreateFixture(&groundShape, 0);
+
+    ex::EventManager events;
+    ex::EntityManager entities(events);
+    std::vector<ex::Entity> all;
+    dropRows(world, entities, all, count);
+
+    WorldHistory history;
+    history.setLimits(std::size_t(1) << 30, 0, precision);
+
+    //Exact states of the first `present[f]` bodies of `all` at each recorded frame
+    std::vector<std::vector<Sample>> exact;
+    std::vector<std::size_t> present;
+    std::vector<double> times;
+    int added = count / 2;
+    int spawnFrame = frames / 2, throwFrame = frames / 4;
+    for(int f = 0; f != frames; ++f) {
+        if(f == spawnFrame)
+            dropRows(world, entities, all, added);
+        b2Body* thrown = all[0].component<Box2DComponent>()->body;
+        if(f == throwFrame)
+            thrown->SetTransform(b2Vec2(1e7f, -1e7f), 0);
+        else if(f == throwFrame + 1)
+            thrown->SetTransform(b2Vec2(-1e7f, 1e7f), 0);
+        world.Step(dt, 8, 3);
+        history.record(world, (f + 1) * dt);
+
+        times.push_back((f + 1) * dt);
+        present.push_back(all.size());
+        exact.emplace_back();
+        for(ex::Entity e : all)
+            exact.back().push_back(sample(e.component<Box2DComponent>()->body));
+    }
+    std::printf("%d bodies, %zu frames, %.1f KB (%.0f bytes a frame)\n", count + added, history.frames(),
+                history.bytes() / 1024.0, double(history.bytes()) / history.frames());
+
+    int failures = 0;
+    if(history.frames() != std::size_t(frames)) {
+        std::printf("Recorded %zu frames of %d\n", history.frames(), frames);
+        ++failures;
+    }
+
+    //Every few frames, and each side of the throw and the second drop
+    std::vector<int> checked = {0, throwFrame - 1, throwFrame, throwFrame + 1, throwFrame + 2,
+                                spawnFrame - 1, spawnFrame, frames - 1};
+    for(int f = 0; f < frames; f += 37)
+        checked.push_back(f);
+    for(int f : checked) {
+        if(history.frameAt(times[f]) != std::size_t(f) || history.timeOf(f) != times[f]) {
+            std::printf("Frame %d: found at %zu\n", f, history.frameAt(times[f]));
+            ++failures;
+        }
+        history.restore(f, entities);
+        for(std::size_t i = 0; i != present[f]; ++i) {
+            Sample now = sample(all[i].component<Box2DComponent>()->body);
+            const Sample& then = exact[f][i];
+            bool ok = matches(now.position.x, then.position.x, precision.position) &&
+                      matches(now.position.y, then.position.y, precision.position) &&
+                      anglesMatch(now.angle, then.angle) &&
+                      matches(now.velocity.x, then.velocity.x, precision.velocity) &&
+                      matches(now.velocity.y, then.velocity.y, precision.velocity) &&
+                      matches(now.spin, then.spin, precision.velocity);
+            if(!ok) {
+                std::printf("Frame %d, body %zu: (%g, %g) %g (%g, %g) %g, recorded (%g, %g) %g (%g, %g) %g\n",
+                            f, i, now.position.x, now.position.y, now.angle, now.velocity.x, now.velocity.y,
+                            now.spin, then.position.x, then.position.y, then.angle, then.velocity.x,
+                            then.velocity.y, then.spin);
+                ++failures;
+            }
+        }
+    }
+
+    //Going back to before the second drop forgets it, and those bodies with it
+    std::vector<ex::Entity::Id> gone;
+    history.truncate(spawnFrame - 1, gone);
+    std::sort(gone.begin(), gone.end());
+    std::vector<ex::Entity::Id> later;
+    for(std::size_t i = count; i != all.size(); ++i)
+        later.push_back(all[i].id());
+    std::sort(later.begin(), later.end());
+    if(gone != later || history.frames() != std::size_t(spawnFrame)) {
+        std::printf("Truncating to frame %d: %zu frames left, %zu bodies gone of %zu\n", spawnFrame - 1,
+                    history.frames(), gone.size(), later.size());
+        ++failures;
+    }
+
+    std::printf("Checked %zu frames: %d mismatches\n", checked.size(), failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
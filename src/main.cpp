@@ -1,72 +1,303 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sys/stat.h>
 #include <SFML/Graphics.hpp>
 #include <entityx/entityx.h>
-#include "utility/keyvalues.h"
+#include "utility/config.h"
+#include "sdl2d3/shapeasset.h"
+#include "sdl2d3/level.h"
+#include "sdl2d3/simulation.h"
+#include "utility/AllocTracker.h"
+#include "utility/FrameDumper.h"
+#include "utility/JobSystem.h"
+#include "utility/trace.h"
 
 //Entity X systems
 #include "sdl2d3/systems/Box2DSystem.h"
 #include "sdl2d3/systems/SFGUISystem.h"
 #include "sdl2d3/systems/LTBLSystem.h"
 #include "sdl2d3/systems/TextureSystem.h"
+#include "sdl2d3/systems/ParticleSystem.h"
+#include "sdl2d3/systems/GovernorSystem.h"
 
-class SDL2D3 : public entityx::EntityX
+class SDL2D3 : public entityx::EntityX, public entityx::Receiver<SDL2D3>
 {
 public:
     SDL2D3(int argc, char** argv);
     void update(entityx::TimeDelta dt);
     void run();
+    void receive(const TimeEvent& e);
 
 private:
-    KeyValue keys;              //Interface to keys file
+    void reloadConfig();
+    void runOffscreen();
+    void spawnScripted();
+    void profileAllocations();
+    void writeTrace();
+    template<typename S> float updateSystem(alloc::Tag tag, entityx::TimeDelta dt);
+    float particleTime(float dt);
+
+    Config config;              //Typed config, from config.ini
+    ShapeLibrary shapes;        //Decomposed shape files, shared by every spawn
+    Level level;                //Static tile geometry, built once at startup
+    std::unique_ptr<JobSystem> jobs;    //Worker threads for per-entity loops, sized by config
+    sf::Clock reloadClock;      //Time since the config file was last checked
     sf::RenderWindow window;    //Render window created here
+    sf::RenderTexture canvas;   //Drawn to instead of the window in offscreen mode
+    sf::RenderTarget* target;   //Whichever of the two the systems draw to
+    bool offscreen;
+
+    //Simulation speed; physics and particles get the frame time times `timeScale`
+    float timeScale;
+    int renderSkip;             //Frames only stepping physics and particles between drawn ones
+
+    //Milliseconds each system took in the last update, for the offscreen timings
+    struct { float physics, texture, particles, light, gui; } timing;
+
+    //Allocation counters at the end of the last frame, and the last frame's totals over all tags
+    alloc::Counters allocTotals[alloc::TAG_COUNT] = {};
+    alloc::Counters frameAllocs = {};
 };
 
 SDL2D3::SDL2D3(int argc, char** argv)
 {
-    //Load a key=value config file
+    //Load a key=value config file. Bad or missing values fall back to defaults
     std::string path = (argc > 1) ? argv[1] : "config.ini";
-    keys.LoadFromFile(path);
-
-    //Initialize our SFML window
-    int width  = keys.GetInt("WIDTH");
-    int height = keys.GetInt("HEIGHT");
-    if(width == 0 || height == 0) {
-        std::cerr << "Invalid Window width and height" << std::endl;
-        std::exit(1);
+    config.load(path);
+    trace::setEnabled(config.getBool(cfg::TRACE_ENABLED));
+    trace::setThreadName("Main");
+
+    //Initialize our SFML window, or an offscreen texture of the same size
+    int width  = config.getInt(cfg::WIDTH);
+    int height = config.getInt(cfg::HEIGHT);
+    offscreen = config.getBool(cfg::OFFSCREEN);
+    if(offscreen) {
+        canvas.create(width, height);
+        target = &canvas;
+    } else {
+        auto style = sf::Style::Titlebar | sf::Style::Close;
+        sf::ContextSettings settings;
+        settings.antialiasingLevel = 4;
+        window.create(sf::VideoMode(width, height), "SDL2D3", style, settings);
+        window.setFramerateLimit(60);
+        target = &window;
     }
-    auto style = sf::Style::Titlebar | sf::Style::Close;
-    sf::ContextSettings settings;
-    settings.antialiasingLevel = 4;
-    window.create(sf::VideoMode(width, height), "SDL2D3", style, settings);
-    window.setFramerateLimit(60);
-
-    //Initialize systems
-    systems.add<Box2DSystem>(window);
-    systems.add<SFGUISystem>(window, entities, events);
-    systems.add<LTBLSystem>(window, entities, keys);
-    systems.add<TextureSystem>(window,entities, keys);
+
+    TRACE_SCOPE("SDL2D3::init");
+
+    //Load the static level. Colliders, occluders and its texture are baked from it once
+    level.load(config.getString(cfg::LEVEL_FILE), config.getFloat(cfg::LEVEL_TILE_SIZE));
+    jobs = std::make_unique<JobSystem>(JobSystem::workersFor(config.getInt(cfg::JOB_THREADS)));
+
+    //Initialize systems. There is no GUI without a window, and offscreen runs
+    //keep full quality so their frames stay comparable
+    systems.add<Box2DSystem>(*target, entities, config, level, *jobs);
+    if(!offscreen)
+        systems.add<SFGUISystem>(window, entities, events, config, shapes);
+    systems.add<LTBLSystem>(*target, entities, config, level, *jobs);
+    systems.add<TextureSystem>(*target, entities, config, level, *jobs);
+    systems.add<ParticleSystem>(*target, entities, config, level, *jobs);
+    if(!offscreen)
+        systems.add<GovernorSystem>(config);
     systems.configure();
+
+    timeScale = config.getFloat(cfg::TIME_SCALE);
+    renderSkip = config.getInt(cfg::TIME_RENDER_SKIP);
+    events.subscribe<TimeEvent>(*this);
+}
+
+void SDL2D3::receive(const TimeEvent& e)
+{
+    switch(e.type) {
+    case TimeEvent::Scale:
+        timeScale = e.scale;
+        break;
+    case TimeEvent::RenderSkip:
+        renderSkip = std::max(0, e.frames);
+        break;
+    }
+}
+
+float SDL2D3::particleTime(float dt)
+{
+    //Frame time at the time scale, or none while the physics is
+    //paused for rewinding; the Box2DSystem handles its own pause
+    return systems.system<Box2DSystem>()->isPaused() ? 0 : dt * timeScale;
 }
 
 void SDL2D3::update(entityx::TimeDelta dt)
 {
-    systems.update<Box2DSystem>(dt);
-    systems.update<TextureSystem>(dt);
-    systems.update<LTBLSystem>(dt);
-    systems.update<SFGUISystem>(dt);
+    //Only the simulation runs at the time scale; the GUI and governor keep wall time
+    timing.physics   = updateSystem<Box2DSystem>(alloc::Physics, dt * timeScale);
+    timing.texture   = updateSystem<TextureSystem>(alloc::Texture, dt);
+    timing.particles = updateSystem<ParticleSystem>(alloc::Particles, particleTime(dt));
+    timing.light     = updateSystem<LTBLSystem>(alloc::Light, dt);
+    timing.gui       = offscreen ? 0 : updateSystem<SFGUISystem>(alloc::Gui, dt);
+
+    //The governor judges the frame by the work above, not by time display() spends waiting
+    if(!offscreen) {
+        systems.system<GovernorSystem>()->addSample(timing.physics + timing.texture + timing.particles +
+                                                      timing.light + timing.gui);
+        systems.update<GovernorSystem>(dt);
+    }
+}
+
+template<typename S>
+float SDL2D3::updateSystem(alloc::Tag tag, entityx::TimeDelta dt)
+{
+    //Time one system's update, and count its allocations under `tag`
+    alloc::Scope scope(tag);
+    sf::Clock clock;
+    systems.update<S>(dt);
+    return clock.getElapsedTime().asMicroseconds() / 1000.f;
+}
+
+void SDL2D3::profileAllocations()
+{
+    //Turn the running counters into this frame's figures and publish them
+    if(!alloc::tracking)
+        return;
+    ProfileEvent profile;
+    frameAllocs = {0, 0, 0};
+    for(int i = 0; i != alloc::TAG_COUNT; ++i) {
+        alloc::Counters now = alloc::read(alloc::Tag(i));
+        profile.tags[i] = {now.allocations - allocTotals[i].allocations, now.bytes - allocTotals[i].bytes, now.live};
+        frameAllocs.allocations += profile.tags[i].allocations;
+        frameAllocs.bytes += profile.tags[i].bytes;
+        frameAllocs.live += now.live;
+        allocTotals[i] = now;
+    }
+    events.emit<ProfileEvent>(profile);
+}
+
+void SDL2D3::reloadConfig()
+{
+    //Check the config file for edits about once a second and tell the systems
+    if(!config.getBool(cfg::CONFIG_HOT_RELOAD) || reloadClock.getElapsedTime() < sf::seconds(1))
+        return;
+    reloadClock.restart();
+
+    Config::KeySet changed = config.reloadIfChanged();
+    if(changed.test(cfg::WIDTH) || changed.test(cfg::HEIGHT))
+        std::cerr << "Config: WIDTH and HEIGHT take effect after a restart" << std::endl;
+    if(changed.test(cfg::JOB_THREADS))
+        std::cerr << "Config: JOB_THREADS takes effect after a restart" << std::endl;
+    if(changed.test(cfg::TIME_SCALE))
+        timeScale = config.getFloat(cfg::TIME_SCALE);
+    if(changed.test(cfg::TIME_RENDER_SKIP))
+        renderSkip = config.getInt(cfg::TIME_RENDER_SKIP);
+    if(changed.test(cfg::TRACE_ENABLED))
+        trace::setEnabled(config.getBool(cfg::TRACE_ENABLED));
+    if(changed.test(cfg::LEVEL_FILE) || changed.test(cfg::LEVEL_TILE_SIZE))
+        std::cerr << "Config: LEVEL_FILE and LEVEL_TILE_SIZE take effect after a restart" << std::endl;
+    if(changed.any())
+        events.emit<ConfigEvent>(ConfigEvent{changed});
 }
 
 void SDL2D3::run()
 {
+    if(offscreen) {
+        runOffscreen();
+        writeTrace();
+        return;
+    }
     sf::Clock clock;
 
     /* window.pollEvent et al is handled in the SFGUISystem update()
      * the reason is to more cleanly filter events and pass to other systems */
     while (window.isOpen())
     {
+        TRACE_SCOPE("SDL2D3::frame");
+        reloadConfig();
+        float dt = clock.restart().asSeconds();
+
+        /* Fast forward by skipping frames: the physics and particles are stepped for each
+         * one without drawing, so there is no wait for display(). Every frame then simulates
+         * a fixed 1/60 s, drawn or not, as the wall time of a drawn frame covers the skipped ones */
+        if(renderSkip > 0) {
+            dt = 1.f / 60;
+            alloc::Scope scope(alloc::Physics);
+            for(int i = 0; i != renderSkip; ++i) {
+                systems.system<Box2DSystem>()->advance(events, dt * timeScale);
+                alloc::Scope particles(alloc::Particles);
+                systems.system<ParticleSystem>()->advance(particleTime(dt));
+            }
+        }
+
         window.clear({100,100,100});
-        update(clock.restart().asSeconds());
+        update(dt);
         window.display();
+        profileAllocations();
     }
+    writeTrace();
+}
+
+void SDL2D3::writeTrace()
+{
+    if(!trace::enabled())
+        return;
+    const std::string& path = config.getString(cfg::TRACE_FILE);
+    if(!trace::write(path))
+        std::cerr << "Trace: Couldn't write " << path << std::endl;
+}
+
+void SDL2D3::runOffscreen()
+{
+    /* A fixed step keeps runs reproducible, so dumped frames can be compared
+     * between builds. Frame times are measured before the readback for dumps */
+    const float dt = 1.f / 60;
+    int frames = config.getInt(cfg::OFFSCREEN_FRAMES);
+    int dumpEvery = config.getInt(cfg::OFFSCREEN_DUMP_EVERY);
+    std::string dir = config.getString(cfg::OFFSCREEN_DUMP_DIR);
+    if(mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        std::cerr << "Offscreen: Couldn't create " << dir << ": " << std::strerror(errno) << std::endl;
+
+    std::ofstream csv(dir + "/timing.csv");
+    if(!csv.is_open())
+        std::cerr << "Offscreen: Couldn't write " << dir << "/timing.csv" << std::endl;
+    csv << "frame,physics_ms,texture_ms,particle_ms,light_ms,frame_ms";
+    csv << (alloc::tracking ? ",allocations,alloc_bytes,live_bytes\n" : "\n");
+
+    FrameDumper dumper;
+    spawnScripted();
+    for(int frame = 0; frames == 0 || frame != frames; ++frame) {
+        TRACE_SCOPE("SDL2D3::frame");
+        sf::Clock clock;
+        canvas.clear({100,100,100});
+        update(dt);
+        canvas.display();
+        float frameTime = clock.getElapsedTime().asMicroseconds() / 1000.f;
+        profileAllocations();
+        csv << frame << ',' << timing.physics << ',' << timing.texture << ',' << timing.particles << ','
+            << timing.light << ',' << frameTime;
+        if(alloc::tracking)
+            csv << ',' << frameAllocs.allocations << ',' << frameAllocs.bytes << ',' << frameAllocs.live;
+        csv << '\n';
+
+        if(dumpEvery > 0 && frame % dumpEvery == 0) {
+            TRACE_SCOPE("SDL2D3::readback");
+            char name[32];
+            std::snprintf(name, sizeof name, "/frame_%06d.png", frame);
+            dumper.push(canvas.getTexture().copyToImage(), dir + name);
+        }
+    }
+}
+
+void SDL2D3::spawnScripted()
+{
+    //Drop a grid of alternating boxes and balls under gravity. Rows wrap around within
+    //the upper half of the screen, so large counts start overlapped and push apart
+    PhysicsEvent gravity(PhysicsEvent::GravityChange);
+    gravity.grav.Set(0, 10);
+    events.emit<PhysicsEvent>(gravity);
+
+    dropBodies(entities, target->getSize(), config.getInt(cfg::OFFSCREEN_SPAWN));
 }
 
 
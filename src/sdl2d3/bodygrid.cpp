@@ -0,0 +1,33 @@
+#include <algorithm>
+#include "sdl2d3/components.h"
+#include "bodygrid.h"
+
+void BodyGrid::rebuild(b2World& world)
+{
+    grid.clear();
+    fixtures.clear();
+    for(b2Body* body = world.GetBodyList(); body != nullptr; body = body->GetNext()) {
+        if(bodyEntityId(body) == entityx::Entity::INVALID)
+            continue;
+        for(b2Fixture* fixture = body->GetFixtureList(); fixture != nullptr; fixture = fixture->GetNext()) {
+            //Entity bodies have no chain shapes, so one child each
+            const b2AABB& box = fixture->GetAABB(0);
+            b2Vec2 center = box.GetCenter();
+            b2Vec2 extents = box.GetExtents();
+            grid.add(center.x, center.y, std::max(extents.x, extents.y), fixtures.size());
+            fixtures.push_back(fixture);
+        }
+    }
+    grid.build();
+}
+
+void BodyGrid::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
+{
+    //The grid can't stop early, so once the callback asks to stop the rest are skipped
+    bool searching = true;
+    grid.query(aabb.lowerBound.x, aabb.lowerBound.y, aabb.upperBound.x, aabb.upperBound.y,
+               [&](std::uint32_t i) {
+        if(searching)
+            searching = callback->ReportFixture(fixtures[i]);
+    });
+}
@@ -0,0 +1,30 @@
+#ifndef SDL2D3_BODYGRID_H
+#define SDL2D3_BODYGRID_H
+#include <vector>
+#include <Box2D/Box2D.h>
+#include "utility/SpatialGrid.h"
+
+/* Optional broadphase for our own queries (BROADPHASE=grid), for scenes made
+ * mostly of the same few body sizes. The fixtures of entity bodies are put in
+ * a uniform grid, rebuilt in one linear pass rather than updated proxy by proxy
+ * like Box2D's tree. Box2D still uses its tree for contacts; only batched
+ * region queries, such as picking entities to remove, go through the grid.
+ * Static bodies (the level and walls) have no entity, so they are left out. */
+
+class BodyGrid
+{
+public:
+    //Refile every fixture of every body that has an entity
+    void rebuild(b2World& world);
+
+    //Same contract as b2World::QueryAABB, over the fixtures filed at the last rebuild
+    void QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const;
+
+    std::size_t size() const { return fixtures.size(); }
+
+private:
+    SpatialGrid grid;
+    std::vector<b2Fixture*> fixtures;   //By grid value
+};
+
+#endif // SDL2D3_BODYGRID_H
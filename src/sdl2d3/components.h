@@ -1,18 +1,24 @@
 #ifndef SDL2D3_COMPONENTS_H
 #define SDL2D3_COMPONENTS_H
+#include <cstdint>
 #include <Box2D/Box2D.h>
+#include <entityx/entityx.h>
 #include <ltbl/lighting/LightSystem.h>
 
+struct ShapeAsset;
+
 /* EntityX components. These are properties given to an entity
  * corrisponding to each library the entity is used in. */
 
 //Component given from GUI as where to spawn the entity
 struct SpawnComponent
 {
-    enum TYPE { CIRCLE=0, BOX=1 } type;  //Type of shape
+    enum TYPE { CIRCLE=0, BOX=1, POLYGON=2 } type;  //Type of shape
     int x, y;   //Initial spawn position
+    std::shared_ptr<const ShapeAsset> asset;        //Shape file data, for POLYGON
 
-    SpawnComponent(float x, float y, TYPE t) : type(t), x(x), y(y) { }
+    SpawnComponent(float x, float y, TYPE t, std::shared_ptr<const ShapeAsset> asset = nullptr)
+        : type(t), x(x), y(y), asset(asset) { }
 };
 
 //Handle to a body in the Box2D physics engine
@@ -22,11 +28,36 @@ struct Box2DComponent
     b2Body* body;
 };
 
-//Handle to a light occulder in the LTBL system
+/* The way back, from a body to its entity, is the entity's id in the body's
+ * user data; Box2D 2.3 only has a void* to spare, so the 64 bit id is stored
+ * in it directly. Ids carry a version, so a body outliving its entity (or an
+ * id whose slot was reused) is told apart by EntityManager::valid() */
+static_assert(sizeof(void*) >= sizeof(std::uint64_t), "Entity ids don't fit in b2Body user data");
+
+inline void setBodyEntity(b2Body* body, entityx::Entity::Id id)
+{
+    body->SetUserData(reinterpret_cast<void*>(static_cast<std::uintptr_t>(id.id())));
+}
+
+//Id stored in the body; Entity::INVALID for bodies without an entity, such as the level's
+inline entityx::Entity::Id bodyEntityId(const b2Body* body)
+{
+    std::uintptr_t data = reinterpret_cast<std::uintptr_t>(body->GetUserData());
+    return data ? entityx::Entity::Id(std::uint64_t(data)) : entityx::Entity::INVALID;
+}
+
+//The body's entity, or an invalid Entity if it has none or it has been destroyed
+inline entityx::Entity bodyEntity(entityx::EntityManager& entities, const b2Body* body)
+{
+    entityx::Entity::Id id = bodyEntityId(body);
+    return entities.valid(id) ? entities.get(id) : entityx::Entity();
+}
+
+//Handle to the light occulders in the LTBL system; one per convex part of the body
 struct LTBLComponent
 {
-    LTBLComponent(std::shared_ptr<ltbl::LightShape> light) : light(light) { }
-    std::shared_ptr<ltbl::LightShape> light;
+    LTBLComponent(std::vector<std::shared_ptr<ltbl::LightShape>> lights) : lights(lights) { }
+    std::vector<std::shared_ptr<ltbl::LightShape>> lights;
 };
 
 //Handle to an image texture to draw with SFML over the entity
@@ -34,7 +65,8 @@ struct TextureComponent
 {
     TextureComponent(sf::Sprite sprite) : sprite(sprite) { }
     sf::Sprite sprite;
-    sf::Text positionText;
+    float radius = 0;       //Furthest the sprite reaches from the body, pixels. For culling
+    bool visible = false;   //Inside the view this frame; set by TextureSystem::update
 };
 
 #endif // SDL2D3_COMPONENTS_H
@@ -0,0 +1,117 @@
+#ifndef SDL2D3_COMPONENT_VIEW_H
+#define SDL2D3_COMPONENT_VIEW_H
+
+#include <vector>
+#include <entityx/entityx.h>
+#include "utility/JobSystem.h"
+namespace ex = entityx;
+
+/* A persistent list of the entities that have all of `Components`. EntityX's
+ * entities_with_components() tests the component mask of every entity slot,
+ * dead ones included, so its cost grows with every entity ever spawned. A view
+ * is kept up to date from component added/removed events instead, and only
+ * holds matching live entities, packed.
+ *
+ * Removal swaps the last entity into the gap, so components of the viewed
+ * types must not be added or removed while iterating a view of them */
+
+template <typename... Components>
+class ComponentView : public ex::Receiver<ComponentView<Components...>>
+{
+public:
+    typedef typename std::vector<ex::Entity>::const_iterator const_iterator;
+
+    //Subscribe to component changes, and pick up any entities that already match
+    void configure(ex::EntityManager& entities, ex::EventManager& events)
+    {
+        int subscribe[] = {
+            (events.subscribe<ex::ComponentAddedEvent<Components>>(*this),
+             events.subscribe<ex::ComponentRemovedEvent<Components>>(*this), 0)...
+        };
+        (void)subscribe;
+        for(ex::Entity e : entities.entities_with_components<Components...>())
+            insert(e);
+    }
+
+    const ex::Entity& operator[](std::size_t i) const { return dense[i]; }
+    const_iterator begin() const { return dense.begin(); }
+    const_iterator end() const { return dense.end(); }
+    std::size_t size() const { return dense.size(); }
+    bool empty() const { return dense.empty(); }
+
+    //Call f(entity, components...) for each entity in the view
+    template <typename F>
+    void each(F f) const
+    {
+        for(ex::Entity e : dense)
+            f(e, *e.component<Components>()...);
+    }
+
+    //As each(), with the entities split between the job system's threads in
+    //chunks of `grain`. `f` may only write to its own entity's components
+    template <typename F>
+    void parallel_each(JobSystem& jobs, std::size_t grain, F f) const
+    {
+        jobs.parallel_for(dense.size(), grain, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i != end; ++i) {
+                ex::Entity e = dense[i];
+                f(e, *e.component<Components>()...);
+            }
+        });
+    }
+
+    template <typename C>
+    void receive(const ex::ComponentAddedEvent<C>& e)
+    {
+        if(hasAll(e.entity))
+            insert(e.entity);
+    }
+
+    template <typename C>
+    void receive(const ex::ComponentRemovedEvent<C>& e)
+    {
+        erase(e.entity);
+    }
+
+private:
+    static bool hasAll(ex::Entity e)
+    {
+        bool has[] = {e.has_component<Components>()...};
+        for(bool h : has)
+            if(!h)
+                return false;
+        return true;
+    }
+
+    void insert(ex::Entity e)
+    {
+        std::size_t index = e.id().index();
+        if(index >= slots.size())
+            slots.resize(index + 1, npos);
+        if(slots[index] != npos)
+            return;
+        slots[index] = dense.size();
+        dense.push_back(e);
+    }
+
+    void erase(ex::Entity e)
+    {
+        std::size_t index = e.id().index();
+        if(index >= slots.size() || slots[index] == npos)
+            return;
+        std::size_t at = slots[index];
+        dense[at] = dense.back();
+        slots[dense[at].id().index()] = at;
+        dense.pop_back();
+        slots[index] = npos;
+    }
+
+    static constexpr std::size_t npos = std::size_t(-1);
+    std::vector<ex::Entity> dense;      //Matching entities, packed
+    std::vector<std::size_t> slots;     //Position in `dense` by entity index, or npos
+};
+
+template <typename... Components>
+constexpr std::size_t ComponentView<Components...>::npos;
+
+#endif // SDL2D3_COMPONENT_VIEW_H
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include "contacts.h"
+
+ContactRecorder::ContactRecorder(std::size_t capacity, float minImpulse)
+    : overflow(0)
+{
+    setLimits(capacity, minImpulse);
+}
+
+void ContactRecorder::setLimits(std::size_t newCapacity, float newMinImpulse)
+{
+    capacity = newCapacity;
+    minImpulse = newMinImpulse;
+    records.reserve(capacity);
+}
+
+void ContactRecorder::clear()
+{
+    records.clear();
+    overflow = 0;
+}
+
+Contact* ContactRecorder::next()
+{
+    //Never grow past the reserved size in the middle of a step
+    if(records.size() >= capacity) {
+        ++overflow;
+        return nullptr;
+    }
+    records.emplace_back();
+    return &records.back();
+}
+
+void ContactRecorder::BeginContact(b2Contact* contact)
+{
+    Contact* record = next();
+    if(record == nullptr)
+        return;
+    b2WorldManifold manifold;
+    contact->GetWorldManifold(&manifold);
+    record->type = Contact::Begin;
+    record->a = bodyEntityId(contact->GetFixtureA()->GetBody());
+    record->b = bodyEntityId(contact->GetFixtureB()->GetBody());
+    record->point = contact->GetManifold()->pointCount ? manifold.points[0] : b2Vec2_zero;
+    record->normal = manifold.normal;
+    record->impulse = 0;
+}
+
+void ContactRecorder::EndContact(b2Contact* contact)
+{
+    Contact* record = next();
+    if(record == nullptr)
+        return;
+    record->type = Contact::End;
+    record->a = bodyEntityId(contact->GetFixtureA()->GetBody());
+    record->b = bodyEntityId(contact->GetFixtureB()->GetBody());
+    record->point = b2Vec2_zero;
+    record->normal = b2Vec2_zero;
+    record->impulse = 0;
+}
+
+void ContactRecorder::PostSolve(b2Contact* contact, const b2ContactImpulse* impulse)
+{
+    //Called for every touching contact each step, so resting contacts are filtered out first
+    int count = contact->GetManifold()->pointCount;
+    float strongest = 0;
+    for(int i = 0; i != count; ++i)
+        strongest = std::max(strongest, impulse->normalImpulses[i]);
+    if(count == 0 || strongest < minImpulse)
+        return;
+
+    Contact* record = next();
+    if(record == nullptr)
+        return;
+    b2WorldManifold manifold;
+    contact->GetWorldManifold(&manifold);
+    record->type = Contact::Impact;
+    record->a = bodyEntityId(contact->GetFixtureA()->GetBody());
+    record->b = bodyEntityId(contact->GetFixtureB()->GetBody());
+    record->point = manifold.points[0];
+    record->normal = manifold.normal;
+    record->impulse = strongest;
+}
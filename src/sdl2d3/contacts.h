@@ -0,0 +1,54 @@
+#ifndef SDL2D3_CONTACTS_H
+#define SDL2D3_CONTACTS_H
+#include <cstdint>
+#include <vector>
+#include <Box2D/Box2D.h>
+#include <entityx/entityx.h>
+#include "sdl2d3/components.h"
+namespace ex = entityx;
+
+/* Collision data for game logic. Box2D reports contacts through callbacks in
+ * the middle of b2World::Step; emitting an EntityX event from each would cost
+ * a dispatch per contact. The recorder instead appends fixed-size records to a
+ * buffer reserved up front, and the Box2DSystem publishes the whole buffer as
+ * one ContactBatchEvent after stepping. */
+
+struct Contact
+{
+    enum TYPE : std::uint8_t {
+        Begin,  //!<Two fixtures started touching
+        End,    //!<They stopped touching, or one of the bodies was destroyed
+        Impact  //!<The solver pushed them apart harder than CONTACT_IMPULSE_MIN
+    } type;
+    ex::Entity::Id a, b;    //!<Entities of the two bodies, or Entity::INVALID for the level
+    b2Vec2 point;           //!<World point in meters, for Begin and Impact
+    b2Vec2 normal;          //!<From a to b, for Begin and Impact
+    float impulse;          //!<Largest normal impulse of the contact points, for Impact
+};
+
+class ContactRecorder : public b2ContactListener
+{
+public:
+    //Hold up to `capacity` contacts between publishes; more are counted and dropped
+    ContactRecorder(std::size_t capacity, float minImpulse);
+    void setLimits(std::size_t capacity, float minImpulse);
+
+    const std::vector<Contact>& contacts() const { return records; }
+    std::size_t dropped() const { return overflow; }
+    void clear();
+
+    //b2ContactListener; called by b2World::Step, and EndContact by DestroyBody
+    void BeginContact(b2Contact* contact) override;
+    void EndContact(b2Contact* contact) override;
+    void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) override;
+
+private:
+    Contact* next();
+
+    std::vector<Contact> records;
+    std::size_t capacity;
+    std::size_t overflow;
+    float minImpulse;
+};
+
+#endif // SDL2D3_CONTACTS_H
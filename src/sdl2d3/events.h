@@ -2,24 +2,114 @@
 #define SDL2D3_EVENTS_H
 #include <SFML/Graphics.hpp>
 #include <Box2D/Common/b2Math.h>
+#include <Box2D/Dynamics/b2TimeStep.h>
+#include "utility/AllocTracker.h"
+#include "utility/config.h"
+#include "sdl2d3/contacts.h"
 
 struct PhysicsEvent
 {
     enum TYPE {
         WindowCollision, //!<Emitted on "Window Collision" checkbox change
         GravityChange,   //!<Emitted on a gravity slider chagned
-        EntityRemoveReq  //!<Emiited on a middle click
+        EntityRemoveReq, //!<Emiited on a middle click
+        VelocityIterations, //!<Solver settings from the Box2D tab
+        PositionIterations,
+        Substeps,
+        Density,
+        BoxRestitution,
+        CircleRestitution,
+        WarmStarting,
+        ContinuousCollision,
+        Pause,           //!<From the history timeline; resuming carries on from the shown point
+        HistorySeek      //!<Show a recorded state and pause there
     } type ;
     union {
-        bool  value; //!<For WindowCollision
+        bool  value; //!<For WindowCollision, WarmStarting, ContinuousCollision, Pause
         b2Vec2 grav; //!<For GravityChange
         b2Vec2 pos;  //!<For EntityRemoveReq
+        int   count; //!<For iteration and substep counts
+        float amount;//!<For Density and restitutions; HistorySeek, 0 the oldest record to 1 the newest
     };
     PhysicsEvent(TYPE type)
         : type(type)
         { }
 };
 
+/* Simulation speed from the Box2D tab. The time scale multiplies the time each
+ * frame simulates; skipped frames step the physics without drawing anything,
+ * each simulating a nominal 1/60 s, so fast forward isn't held to 60 Hz drawing */
+struct TimeEvent
+{
+    enum TYPE {
+        Scale,      //!<Simulated seconds per wall second asked for
+        RenderSkip  //!<Frames stepped without drawing between drawn ones
+    } type;
+    union {
+        float scale;
+        int frames;
+    };
+    TimeEvent(TYPE type)
+        : type(type)
+        { }
+};
+
+//Per-frame cost of the Box2D world, emitted by the Box2DSystem after stepping
+struct PhysicsStatsEvent
+{
+    float stepTime; //!<Milliseconds spent in world->Step this frame
+    float simulated;    //!<Seconds of simulated time stepped
+    int steps;          //!<Steps of at most 1/60 s it took, not counting substeps
+    int bodies;
+    int contacts;
+    int proxies;
+    int joints;
+    int treeHeight;     //!<Broadphase dynamic tree height
+    int treeBalance;    //!<Largest height difference between sibling subtrees
+    float treeQuality;  //!<Total node area over root area; lower is better
+    b2Profile profile;  //!<Step phase times in ms, summed over substeps
+    bool paused;
+    float historySeconds;   //!<Simulated time the rewind history covers
+    std::size_t historyBytes;
+    float rewound;          //!<Seconds before the newest record being shown; 0 when not rewound
+    bool historyReloaded;   //!<HISTORY_ keys were reloaded this step, ending any rewind
+};
+
+/* Every contact recorded since the last batch, emitted once per update by the
+ * Box2DSystem after stepping. The records belong to the Box2DSystem and are
+ * only valid while the event is being received */
+struct ContactBatchEvent
+{
+    const Contact* contacts;
+    std::size_t count;
+    std::size_t dropped;    //!<Contacts that didn't fit in CONTACT_BUFFER
+};
+
+//A burst of particles, from the P key. Position and speed are in pixels
+struct ParticleEvent
+{
+    sf::Vector2f position;
+    int count;
+    float speed;        //!<Fastest initial speed, pixels per second
+    sf::Color color;
+};
+
+/* Particles picked to light up this frame, emitted by the ParticleSystem for the
+ * LTBLSystem. Positions are world pixels; both arrays belong to the ParticleSystem
+ * and are only valid while the event is being received */
+struct ParticleLightsEvent
+{
+    const sf::Vector2f* positions;
+    const sf::Color* colors;
+    std::size_t count;
+};
+
+//Heap use per subsystem, emitted once a frame when built with SDL2D3_TRACK_ALLOCATIONS
+struct ProfileEvent
+{
+    alloc::Counters tags[alloc::TAG_COUNT];  //!<By alloc::Tag. Allocations and bytes are this frame's
+};
+
 /* Any type of relevant graphical change, from Window scaling to any of
  * the "Graphics" checkboxes checked */
 struct GraphicsEvent
@@ -59,4 +149,25 @@ struct LightEvent {
         { }
 };
 
+/* Emitted by the GovernorSystem when it changes the quality level to hold the
+ * frame budget. Levels are cumulative: each keeps the reductions below it */
+struct QualityEvent
+{
+    enum LEVEL {
+        Full,            //!<Everything as configured
+        NoLabels,        //!<Position labels hidden
+        CheapPhysics,    //!<Half the solver iterations, one substep
+        SimpleOccluders, //!<Light occluders with half the outline points
+        LowResLighting,  //!<Lighting rendered at half resolution
+        LEVEL_COUNT
+    } level;
+    float frameTime;     //!<Averaged work per frame that led to the change, ms
+};
+
+//Emitted after the config file was edited and reloaded
+struct ConfigEvent
+{
+    Config::KeySet changed; //!<Keys whose value is different now
+};
+
 #endif
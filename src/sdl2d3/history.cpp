@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cmath>
+#include "sdl2d3/components.h"
+#include "history.h"
+
+namespace {
+
+//Records per segment before a new keyframe, so dropping a segment frees memory steadily
+const std::size_t segmentFrames = 64;
+
+//Quantized values are clamped to +-(2^30 - 1), so the difference of any two fits in
+//an int32. Clamped in double, as a float can't hold the limit exactly
+const double quantizeLimit = (1 << 30) - 1;
+
+void putVarint(std::vector<std::uint8_t>& out, std::uint32_t v)
+{
+    while(v >= 0x80) {
+        out.push_back(std::uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(std::uint8_t(v));
+}
+
+std::uint32_t getVarint(const std::uint8_t*& in)
+{
+    std::uint32_t v = 0;
+    for(int shift = 0;; shift += 7) {
+        std::uint8_t byte = *in++;
+        v |= std::uint32_t(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+            return v;
+    }
+}
+
+//Small negative deltas as small unsigned numbers: 0, -1, 1, -2, 2...
+std::uint32_t zigzag(std::int32_t v)
+{
+    return (std::uint32_t(v) << 1) ^ std::uint32_t(v >> 31);
+}
+
+std::int32_t unzigzag(std::uint32_t v)
+{
+    return std::int32_t((v >> 1) ^ (0u - (v & 1)));
+}
+
+std::int32_t quantizeValue(float value, float precision)
+{
+    double q = std::max(-quantizeLimit, std::min(quantizeLimit, double(value) / precision));
+    return std::int32_t(std::lround(q));
+}
+
+}
+
+WorldHistory::WorldHistory()
+    : frameCount(0)
+    , budget(0)
+    , interval(0)
+    , precision{0.001f, 0.001f, 0.01f}
+{
+}
+
+void WorldHistory::setLimits(std::size_t limit, float seconds, const Precision& p)
+{
+    if(p.position != precision.position || p.angle != precision.angle || p.velocity != precision.velocity)
+        clear();
+    budget = limit;
+    interval = seconds;
+    precision = p;
+    trim();
+}
+
+void WorldHistory::clear()
+{
+    segments.clear();
+    last.clear();
+    frameCount = 0;
+}
+
+std::size_t WorldHistory::Segment::size() const
+{
+    return bytes.size() + ids.size() * sizeof(ids[0]) + frames.size() * sizeof(frames[0]);
+}
+
+std::size_t WorldHistory::bytes() const
+{
+    std::size_t total = 0;
+    for(const Segment& segment : segments)
+        total += segment.size();
+    return total;
+}
+
+double WorldHistory::oldest() const
+{
+    return segments.empty() ? 0 : segments.front().frames.front().time;
+}
+
+double WorldHistory::newest() const
+{
+    return segments.empty() ? 0 : segments.back().frames.back().time;
+}
+
+WorldHistory::State WorldHistory::quantize(const b2Body* body) const
+{
+    //Angles wrap to [-pi, pi) so a spinning body's doesn't grow without bound
+    const b2Vec2& p = body->GetPosition();
+    const b2Vec2& v = body->GetLinearVelocity();
+    float angle = body->GetAngle();
+    angle -= 2 * b2_pi * std::floor((angle + b2_pi) / (2 * b2_pi));
+    return State{{quantizeValue(p.x, precision.position), quantizeValue(p.y, precision.position),
+                  quantizeValue(angle, precision.angle),
+                  quantizeValue(v.x, precision.velocity), quantizeValue(v.y, precision.velocity),
+                  quantizeValue(body->GetAngularVelocity(), precision.velocity)}};
+}
+
+void WorldHistory::record(const b2World& world, double time)
+{
+    if(!segments.empty() && time - newest() < interval)
+        return;
+
+    //Entity bodies in the world's order, which only changes when bodies come or go
+    ids.clear();
+    bodies.clear();
+    for(const b2Body* body = world.GetBodyList(); body != nullptr; body = body->GetNext()) {
+        ex::Entity::Id id = bodyEntityId(body);
+        if(id == ex::Entity::INVALID)
+            continue;
+        ids.push_back(id.id());
+        bodies.push_back(body);
+    }
+    if(segments.empty() || segments.back().frames.size() >= segmentFrames || segments.back().ids != ids)
+        startSegment();
+
+    /* Each record is a run of changed bodies: the number of unchanged bodies
+     * skipped since the last one, a byte with a bit per changed value, then the
+     * change of each of those values */
+    Segment& segment = segments.back();
+    std::uint32_t skipped = 0;
+    for(std::size_t i = 0; i != bodies.size(); ++i) {
+        State q = quantize(bodies[i]);
+        std::uint8_t mask = 0;
+        for(std::size_t c = 0; c != q.size(); ++c)
+            mask |= std::uint8_t(q[c] != last[i][c]) << c;
+        if(mask == 0) {
+            ++skipped;
+            continue;
+        }
+        putVarint(segment.bytes, skipped);
+        skipped = 0;
+        segment.bytes.push_back(mask);
+        for(std::size_t c = 0; c != q.size(); ++c) {
+            if(mask & (1 << c))
+                putVarint(segment.bytes, zigzag(q[c] - last[i][c]));
+        }
+        last[i] = q;
+    }
+    segment.frames.push_back(Frame{time, segment.bytes.size()});
+    ++frameCount;
+    trim();
+}
+
+void WorldHistory::startSegment()
+{
+    spare.bytes.clear();
+    spare.frames.clear();
+    spare.ids = ids;
+    segments.push_back(std::move(spare));
+    spare = Segment();
+    last.assign(ids.size(), State{});
+}
+
+void WorldHistory::trim()
+{
+    //The newest segment stays, as it holds the state recording continues from
+    std::size_t total = bytes();
+    while(segments.size() > 1 && total > budget) {
+        total -= segments.front().size();
+        frameCount -= segments.front().frames.size();
+        spare = std::move(segments.front());
+        segments.pop_front();
+    }
+}
+
+std::size_t WorldHistory::locate(std::size_t& frame) const
+{
+    std::size_t s = 0;
+    while(frame >= segments[s].frames.size()) {
+        frame -= segments[s].frames.size();
+        ++s;
+    }
+    return s;
+}
+
+std::size_t WorldHistory::frameAt(double time) const
+{
+    std::size_t first = 0;
+    for(const Segment& segment : segments) {
+        if(segment.frames.back().time > time) {
+            auto later = std::upper_bound(segment.frames.begin(), segment.frames.end(), time,
+                                          [](double t, const Frame& f) { return t < f.time; });
+            std::size_t index = later - segment.frames.begin();
+            return (index == 0) ? std::max<std::size_t>(first, 1) - 1 : first + index - 1;
+        }
+        first += segment.frames.size();
+    }
+    return frameCount ? frameCount - 1 : 0;
+}
+
+double WorldHistory::timeOf(std::size_t frame) const
+{
+    std::size_t s = locate(frame);
+    return segments[s].frames[frame].time;
+}
+
+void WorldHistory::decode(const Segment& segment, std::size_t frame, std::vector<State>& out) const
+{
+    //A segment's records only make sense in order from its keyframe
+    out.assign(segment.ids.size(), State{});
+    const std::uint8_t* in = segment.bytes.data();
+    for(std::size_t f = 0; f <= frame; ++f) {
+        const std::uint8_t* end = segment.bytes.data() + segment.frames[f].end;
+        std::size_t i = 0;
+        while(in != end) {
+            i += getVarint(in);
+            std::uint8_t mask = *in++;
+            for(std::size_t c = 0; c != out[i].size(); ++c) {
+                if(mask & (1 << c))
+                    out[i][c] += unzigzag(getVarint(in));
+            }
+            ++i;
+        }
+    }
+}
+
+void WorldHistory::restore(std::size_t frame, ex::EntityManager& entities)
+{
+    std::size_t s = locate(frame);
+    const Segment& segment = segments[s];
+    std::vector<State> states;
+    decode(segment, frame, states);
+
+    for(std::size_t i = 0; i != segment.ids.size(); ++i) {
+        ex::Entity::Id id(segment.ids[i]);
+        if(!entities.valid(id))
+            continue;
+        ex::Entity e = entities.get(id);
+        if(!e.has_component<Box2DComponent>())
+            continue;
+        b2Body* body = e.component<Box2DComponent>()->body;
+        const State& q = states[i];
+        body->SetTransform(b2Vec2(q[0] * precision.position, q[1] * precision.position), q[2] * precision.angle);
+        body->SetLinearVelocity(b2Vec2(q[3] * precision.velocity, q[4] * precision.velocity));
+        body->SetAngularVelocity(q[5] * precision.velocity);
+        body->SetAwake(true);
+    }
+}
+
+void WorldHistory::truncate(std::size_t frame, std::vector<ex::Entity::Id>& gone)
+{
+    std::size_t s = locate(frame);
+    Segment& segment = segments[s];
+
+    //Later segments have a different set of bodies; any not in this one came after it
+    std::vector<std::uint64_t> kept = segment.ids;
+    std::sort(kept.begin(), kept.end());
+    std::vector<std::uint64_t> later;
+    for(std::size_t i = s + 1; i != segments.size(); ++i) {
+        for(std::uint64_t id : segments[i].ids) {
+            if(!std::binary_search(kept.begin(), kept.end(), id))
+                later.push_back(id);
+        }
+        frameCount -= segments[i].frames.size();
+    }
+    std::sort(later.begin(), later.end());
+    later.erase(std::unique(later.begin(), later.end()), later.end());
+    for(std::uint64_t id : later)
+        gone.push_back(ex::Entity::Id(id));
+    segments.erase(segments.begin() + s + 1, segments.end());
+
+    frameCount -= segment.frames.size() - (frame + 1);
+    segment.frames.resize(frame + 1);
+    segment.bytes.resize(segment.frames.back().end);
+    decode(segment, frame, last);
+}
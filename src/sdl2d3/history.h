@@ -0,0 +1,92 @@
+#ifndef SDL2D3_HISTORY_H
+#define SDL2D3_HISTORY_H
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <Box2D/Box2D.h>
+#include <entityx/entityx.h>
+namespace ex = entityx;
+
+/* Recent world states for rewinding. Each record holds the position, angle and
+ * velocities of every entity body, rounded to a fixed precision so they become
+ * integers, and stored as the change from the record before it: bodies lying
+ * still cost nothing, and falling ones a few bytes. Records are grouped into
+ * segments that begin with a keyframe, a record against zero, whenever the set of
+ * bodies changes or the segment is full. Whole segments are dropped, oldest
+ * first, to stay within the memory budget. */
+
+class WorldHistory
+{
+public:
+    struct Precision
+    {
+        float position;     //!<Meters
+        float angle;        //!<Radians
+        float velocity;     //!<Meters per second, and radians per second
+    };
+
+    WorldHistory();
+
+    //Keep at most `budget` bytes, one record every `interval` seconds of simulated time.
+    //Changing the precision clears the history
+    void setLimits(std::size_t budget, float interval, const Precision& precision);
+    void clear();
+
+    //Record the entity bodies in `world` at simulated time `time`, if a record is due
+    void record(const b2World& world, double time);
+
+    std::size_t frames() const { return frameCount; }
+    std::size_t bytes() const;
+    double oldest() const;
+    double newest() const;
+
+    //Index of the last record at or before `time`, or the first if none is
+    std::size_t frameAt(double time) const;
+    double timeOf(std::size_t frame) const;
+
+    //Put every body recorded in `frame` whose entity still exists back in its recorded state
+    void restore(std::size_t frame, ex::EntityManager& entities);
+
+    //Forget every record after `frame`, so recording carries on from it. Entities
+    //recorded after it but not in it are added to `gone`
+    void truncate(std::size_t frame, std::vector<ex::Entity::Id>& gone);
+
+private:
+    //x, y, angle, vx, vy, angular velocity; in units of the precision
+    typedef std::array<std::int32_t, 6> State;
+
+    struct Frame
+    {
+        double time;
+        std::size_t end;    //!<Offset in bytes where the record ends
+    };
+
+    struct Segment
+    {
+        std::vector<std::uint64_t> ids;     //!<Entity ids, in the world's body order
+        std::vector<std::uint8_t> bytes;
+        std::vector<Frame> frames;
+        std::size_t size() const;
+    };
+
+    State quantize(const b2Body* body) const;
+    void decode(const Segment& segment, std::size_t frame, std::vector<State>& out) const;
+    void startSegment();
+    void trim();
+    std::size_t locate(std::size_t& frame) const;
+
+    std::deque<Segment> segments;
+    Segment spare;                  //Last dropped segment, reused for the next keyframe
+    std::size_t frameCount;
+    std::size_t budget;
+    float interval;
+    Precision precision;
+
+    //Quantized state of each body in the newest record, and scratch for record()
+    std::vector<State> last;
+    std::vector<std::uint64_t> ids;
+    std::vector<const b2Body*> bodies;
+};
+
+#endif // SDL2D3_HISTORY_H
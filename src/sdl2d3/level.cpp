@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include "utility/trace.h"
+#include "level.h"
+
+bool Level::load(const std::string& path, float size)
+{
+    TRACE_SCOPE("Level::load");
+    rows.clear();
+    loops.clear();
+    rects.clear();
+    width = 0;
+    tileSize = size;
+    if(path.empty())
+        return true;
+
+    std::ifstream file(path);
+    if(!file.is_open()) {
+        std::cerr << "Level: File " << path << " couldn't be found!" << std::endl;
+        return false;
+    }
+    std::string line;
+    while(std::getline(file, line)) {
+        if(!line.empty() && line[0] == ';')
+            continue;
+        rows.push_back(line);
+        width = std::max(width, (int)line.size());
+    }
+
+    buildOutlines();
+    buildBlocks();
+    return true;
+}
+
+bool Level::solid(int x, int y) const
+{
+    if(y < 0 || y >= (int)rows.size() || x < 0 || x >= (int)rows[y].size())
+        return false;
+    return rows[y][x] == '#';
+}
+
+void Level::buildOutlines()
+{
+    /* Every tile side between solid and empty is a boundary edge, directed so
+     * the solid tile is always on the same side. Edges are keyed by their start
+     * corner and then followed corner to corner into closed loops */
+    typedef std::pair<int, int> Corner;
+    std::multimap<Corner, Corner> edges;
+    for(int y = 0; y != (int)rows.size(); ++y) {
+        for(int x = 0; x != width; ++x) {
+            if(!solid(x, y))
+                continue;
+            if(!solid(x - 1, y)) edges.insert({{x, y},         {x, y + 1}});
+            if(!solid(x, y + 1)) edges.insert({{x, y + 1},     {x + 1, y + 1}});
+            if(!solid(x + 1, y)) edges.insert({{x + 1, y + 1}, {x + 1, y}});
+            if(!solid(x, y - 1)) edges.insert({{x + 1, y},     {x, y}});
+        }
+    }
+
+    while(!edges.empty()) {
+        std::vector<Corner> loop;
+        auto edge = edges.begin();
+        Corner start = edge->first;
+        Corner from = start, to = edge->second;
+        edges.erase(edge);
+        loop.push_back(from);
+
+        while(to != start) {
+            /* Two outgoing edges happen where solid tiles touch diagonally.
+             * Take the turn that hugs the tile just walked past, so the two
+             * tiles end up on separate loops instead of a self-touching one */
+            int dx = to.first - from.first, dy = to.second - from.second;
+            auto range = edges.equal_range(to);
+            if(range.first == range.second)
+                break;
+            auto next = range.first;
+            for(auto it = range.first; it != range.second; ++it) {
+                int ox = it->second.first - to.first, oy = it->second.second - to.second;
+                if(dx * oy - dy * ox < 0)
+                    next = it;
+            }
+            //Collinear edges only extend the current side of the outline
+            int nx = next->second.first - to.first, ny = next->second.second - to.second;
+            if(nx != dx || ny != dy)
+                loop.push_back(to);
+            from = to;
+            to = next->second;
+            edges.erase(next);
+        }
+
+        //The start corner may lie in the middle of a straight side
+        if(loop.size() > 2) {
+            Corner a = loop.back(), b = loop[0], c = loop[1];
+            if((b.first - a.first) * (c.second - b.second) == (b.second - a.second) * (c.first - b.first))
+                loop.erase(loop.begin());
+        }
+
+        std::vector<sf::Vector2f> outline;
+        for(const Corner& corner : loop)
+            outline.emplace_back(corner.first * tileSize, corner.second * tileSize);
+        if(outline.size() >= 3)
+            loops.push_back(std::move(outline));
+    }
+}
+
+void Level::buildBlocks()
+{
+    //Greedy meshing: grow each uncovered run of solid tiles downward as far as it stays solid
+    std::vector<std::vector<bool>> covered(rows.size(), std::vector<bool>(width, false));
+    for(int y = 0; y != (int)rows.size(); ++y) {
+        for(int x = 0; x != width; ++x) {
+            if(!solid(x, y) || covered[y][x])
+                continue;
+            int w = 1;
+            while(solid(x + w, y) && !covered[y][x + w])
+                ++w;
+            int h = 1;
+            bool grow = true;
+            while(grow && y + h < (int)rows.size()) {
+                for(int i = 0; i != w && grow; ++i)
+                    grow = solid(x + i, y + h) && !covered[y + h][x + i];
+                if(grow)
+                    ++h;
+            }
+            for(int j = 0; j != h; ++j)
+                for(int i = 0; i != w; ++i)
+                    covered[y + j][x + i] = true;
+            rects.emplace_back(x * tileSize, y * tileSize, w * tileSize, h * tileSize);
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SDL2D3_LEVEL_H
+#define SDL2D3_LEVEL_H
+#include <string>
+#include <vector>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+
+/* Static level geometry loaded from a tile file. Each line of the file is a
+ * row of tiles; '#' is solid and anything else is empty (; starts a comment).
+ * On load, solid tiles are merged into closed outlines for Box2D chain shapes
+ * and into as few rectangles as possible for light occluders and drawing, so
+ * a large level costs a handful of shapes rather than one per tile. */
+
+class Level
+{
+public:
+    //Load a tile file with square tiles of `tileSize` pixels. An empty path is an empty level
+    bool load(const std::string& path, float tileSize);
+
+    //Closed outlines around every solid region, in pixels
+    const std::vector<std::vector<sf::Vector2f>>& outlines() const { return loops; }
+
+    //Solid tiles merged into rectangles, in pixels
+    const std::vector<sf::FloatRect>& blocks() const { return rects; }
+
+    bool empty() const { return rects.empty(); }
+
+private:
+    bool solid(int x, int y) const;
+    void buildOutlines();
+    void buildBlocks();
+
+    std::vector<std::string> rows;
+    int width = 0;
+    float tileSize = 0;
+    std::vector<std::vector<sf::Vector2f>> loops;
+    std::vector<sf::FloatRect> rects;
+};
+
+#endif // SDL2D3_LEVEL_H
@@ -0,0 +1,49 @@
+#include <algorithm>
+#include "parameters.h"
+
+ParameterSet::ParameterSet()
+    : interval(sf::Time::Zero)
+{
+}
+
+void ParameterSet::setInterval(sf::Time i)
+{
+    interval = i;
+}
+
+void ParameterSet::bind(std::initializer_list<sfg::Adjustment::Ptr> adjustments, Publish publish)
+{
+    parameters.emplace_back(new Parameter{publish, sf::Time::Zero, false});
+    Parameter* p = parameters.back().get();
+    for(const sfg::Adjustment::Ptr& adjustment : adjustments) {
+        adjustment->GetSignal(sfg::Adjustment::OnChange)
+            .Connect(std::bind(&ParameterSet::markDirty, this, p));
+    }
+}
+
+void ParameterSet::markDirty(Parameter* p)
+{
+    //Several changes before the next flush collapse into one pending publish
+    if(!p->dirty) {
+        p->dirty = true;
+        dirty.push_back(p);
+    }
+}
+
+void ParameterSet::flush()
+{
+    if(dirty.empty())
+        return;
+
+    //Publish what is due; anything still inside its interval stays pending
+    sf::Time now = clock.getElapsedTime();
+    auto due = [&](Parameter* p) {
+        if(now - p->lastPublished < interval)
+            return false;
+        p->lastPublished = now;
+        p->dirty = false;
+        p->publish();
+        return true;
+    };
+    dirty.erase(std::remove_if(dirty.begin(), dirty.end(), due), dirty.end());
+}
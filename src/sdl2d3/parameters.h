@@ -0,0 +1,45 @@
+#ifndef SDL2D3_PARAMETERS_H
+#define SDL2D3_PARAMETERS_H
+#include <functional>
+#include <memory>
+#include <vector>
+#include <SFGUI/Widgets.hpp>
+#include <SFML/System/Clock.hpp>
+
+/* Live-tunable parameters bound to SFGUI sliders and spin buttons. Instead of
+ * polling every widget each frame, a widget's change signal marks its parameter
+ * dirty. flush() only visits dirty parameters and publishes each at most once
+ * per interval; the publish function reads the widgets, so the last value wins. */
+
+class ParameterSet
+{
+public:
+    typedef std::function<void()> Publish;
+
+    ParameterSet();
+
+    //Publish at most once per `interval` for each parameter
+    void setInterval(sf::Time interval);
+
+    //Bind `publish` to the change signals of every given slider or spin button
+    void bind(std::initializer_list<sfg::Adjustment::Ptr> adjustments, Publish publish);
+
+    //Publish dirty parameters whose interval has elapsed. Call once per frame
+    void flush();
+
+private:
+    struct Parameter
+    {
+        Publish publish;
+        sf::Time lastPublished;
+        bool dirty;
+    };
+    void markDirty(Parameter* p);
+
+    std::vector<std::unique_ptr<Parameter>> parameters;
+    std::vector<Parameter*> dirty;    //Pending parameters, in change order
+    sf::Clock clock;
+    sf::Time interval;
+};
+
+#endif // SDL2D3_PARAMETERS_H
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include "sdl2d3/components.h"
+#include "queries.h"
+
+namespace {
+
+//Keeps the closest fixture along a ray, skipping the ignored entity's body
+class ClosestHit : public b2RayCastCallback
+{
+public:
+    ClosestHit(ex::Entity::Id ignore)
+        : hit{false, ex::Entity::INVALID, b2Vec2_zero, b2Vec2_zero, 1}
+        , ignore(ignore) { }
+    float32 ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float32 fraction) override
+    {
+        ex::Entity::Id id = bodyEntityId(fixture->GetBody());
+        if(ignore != ex::Entity::INVALID && id == ignore)
+            return -1;
+        hit = QueryBatch::RayHit{true, id, point, normal, fraction};
+        return fraction;
+    }
+    QueryBatch::RayHit hit;
+private:
+    ex::Entity::Id ignore;
+};
+
+//Collects the entities whose fixtures overlap `shape`, found from the broadphase by its box.
+//b2TestOverlap bumps Box2D's unsynchronised GJK counters; see queries.h
+class Overlaps : public b2QueryCallback
+{
+public:
+    Overlaps(const b2Shape& shape, std::vector<ex::Entity::Id>& out) : shape(shape), out(out)
+    {
+        identity.SetIdentity();
+    }
+    bool ReportFixture(b2Fixture* fixture) override
+    {
+        ex::Entity::Id id = bodyEntityId(fixture->GetBody());
+        if(id == ex::Entity::INVALID)
+            return true;
+        const b2Shape* other = fixture->GetShape();
+        const b2Transform& xf = fixture->GetBody()->GetTransform();
+        for(int32 child = 0; child != other->GetChildCount(); ++child) {
+            if(b2TestOverlap(&shape, 0, other, child, identity, xf)) {
+                out.push_back(id);
+                break;
+            }
+        }
+        return true;
+    }
+private:
+    const b2Shape& shape;
+    std::vector<ex::Entity::Id>& out;
+    b2Transform identity;
+};
+
+}
+
+void QueryBatch::clear()
+{
+    rayQueries.clear();
+    rayHits.clear();
+    regionQueries.clear();
+    regionHits.clear();
+    regionOffsets.clear();
+}
+
+std::size_t QueryBatch::addRay(const b2Vec2& from, const b2Vec2& to, ex::Entity::Id ignore)
+{
+    rayQueries.push_back(RayQuery{from, to, ignore});
+    return rayQueries.size() - 1;
+}
+
+std::size_t QueryBatch::addBox(const b2Vec2& center, const b2Vec2& halfSize)
+{
+    regionQueries.push_back(RegionQuery{RegionQuery::Box, center, halfSize});
+    return regionQueries.size() - 1;
+}
+
+std::size_t QueryBatch::addCircle(const b2Vec2& center, float radius)
+{
+    regionQueries.push_back(RegionQuery{RegionQuery::Circle, center, b2Vec2(radius, radius)});
+    return regionQueries.size() - 1;
+}
+
+QueryBatch::Span QueryBatch::region(std::size_t i) const
+{
+    const ex::Entity::Id* hits = regionHits.data();
+    return Span{hits + regionOffsets[i], hits + regionOffsets[i + 1]};
+}
+
+void QueryBatch::run(const b2World& world, const BodyGrid* grid, JobSystem& jobs)
+{
+    //Each query only writes its own result slot, so they can all run at once
+    rayHits.resize(rayQueries.size());
+    jobs.parallel_for(rayQueries.size(), 64, [&](std::size_t begin, std::size_t end) {
+        for(std::size_t i = begin; i != end; ++i)
+            castRay(world, i);
+    });
+
+    if(regionScratch.size() < regionQueries.size())
+        regionScratch.resize(regionQueries.size());
+    jobs.parallel_for(regionQueries.size(), 16, [&](std::size_t begin, std::size_t end) {
+        for(std::size_t i = begin; i != end; ++i)
+            overlapRegion(world, grid, i);
+    });
+
+    //Then the per-region lists are packed into one array
+    regionHits.clear();
+    regionOffsets.assign(1, 0);
+    for(std::size_t i = 0; i != regionQueries.size(); ++i) {
+        regionHits.insert(regionHits.end(), regionScratch[i].begin(), regionScratch[i].end());
+        regionOffsets.push_back(regionHits.size());
+    }
+}
+
+void QueryBatch::castRay(const b2World& world, std::size_t i)
+{
+    const RayQuery& query = rayQueries[i];
+    ClosestHit closest(query.ignore);
+    if(b2DistanceSquared(query.from, query.to) > b2_epsilon * b2_epsilon)
+        world.RayCast(&closest, query.from, query.to);
+    rayHits[i] = closest.hit;
+}
+
+void QueryBatch::overlapRegion(const b2World& world, const BodyGrid* grid, std::size_t i)
+{
+    const RegionQuery& query = regionQueries[i];
+    std::vector<ex::Entity::Id>& out = regionScratch[i];
+    out.clear();
+
+    b2CircleShape circle;
+    b2PolygonShape box;
+    const b2Shape* shape = &circle;
+    if(query.shape == RegionQuery::Circle) {
+        circle.m_p = query.center;
+        circle.m_radius = query.extent.x;
+    } else {
+        box.SetAsBox(query.extent.x, query.extent.y, query.center, 0);
+        shape = &box;
+    }
+
+    b2AABB aabb;
+    aabb.lowerBound = query.center - query.extent;
+    aabb.upperBound = query.center + query.extent;
+    Overlaps overlaps(*shape, out);
+    if(grid != nullptr)
+        grid->QueryAABB(&overlaps, aabb);
+    else
+        world.QueryAABB(&overlaps, aabb);
+
+    //Bodies made of several fixtures are reported once per fixture
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
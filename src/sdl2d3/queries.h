@@ -0,0 +1,89 @@
+#ifndef SDL2D3_QUERIES_H
+#define SDL2D3_QUERIES_H
+#include <vector>
+#include <Box2D/Box2D.h>
+#include <entityx/entityx.h>
+#include "utility/JobSystem.h"
+#include "sdl2d3/bodygrid.h"
+namespace ex = entityx;
+
+/* Many world queries at once, for line of sight, sensor and area checks. The
+ * caller fills a batch with raycasts and region overlaps, Box2DSystem::runQueries
+ * answers all of them against the broadphase (split across the job system, as
+ * the world is only read between steps), and the results are read back from
+ * flat arrays by the index each query was added at. A batch kept from frame to
+ * frame reuses its storage, so steady use doesn't allocate.
+ *
+ * One known race: the exact overlap test, b2TestOverlap, goes through b2Distance,
+ * which counts its calls and iterations in Box2D's plain globals (b2_gjkCalls,
+ * b2_gjkIters, b2_gjkMaxIters) from every job thread. Nothing reads them, so the
+ * lost counts are harmless, but a thread sanitizer will report them; see
+ * simulation.h for the same race between worlds. */
+
+class QueryBatch
+{
+public:
+    //Closest thing a ray hit. `entity` is Entity::INVALID for the level and walls
+    struct RayHit
+    {
+        bool hit;
+        ex::Entity::Id entity;
+        b2Vec2 point;       //!<World point, meters
+        b2Vec2 normal;
+        float fraction;     //!<Along the ray, 0 at `from` and 1 at `to`
+    };
+
+    //Entities overlapping one region, each listed once
+    struct Span
+    {
+        const ex::Entity::Id* first;
+        const ex::Entity::Id* last;
+        const ex::Entity::Id* begin() const { return first; }
+        const ex::Entity::Id* end() const { return last; }
+        std::size_t size() const { return last - first; }
+    };
+
+    //Forget all queries and results, keeping the storage
+    void clear();
+
+    //Add a query and return its index. Positions and sizes are in meters. Rays
+    //pass through the body of `ignore`, so an entity can look out from inside itself
+    std::size_t addRay(const b2Vec2& from, const b2Vec2& to, ex::Entity::Id ignore = ex::Entity::INVALID);
+    std::size_t addBox(const b2Vec2& center, const b2Vec2& halfSize);
+    std::size_t addCircle(const b2Vec2& center, float radius);
+
+    //Answer every query; called through Box2DSystem::runQueries. Regions are
+    //found through `grid` if given, else the world's own broadphase
+    void run(const b2World& world, const BodyGrid* grid, JobSystem& jobs);
+
+    //Results of the last run
+    std::size_t rays() const { return rayQueries.size(); }
+    std::size_t regions() const { return regionQueries.size(); }
+    const RayHit& ray(std::size_t i) const { return rayHits[i]; }
+    Span region(std::size_t i) const;
+
+private:
+    struct RayQuery
+    {
+        b2Vec2 from, to;
+        ex::Entity::Id ignore;
+    };
+    struct RegionQuery
+    {
+        enum SHAPE { Box, Circle } shape;
+        b2Vec2 center;
+        b2Vec2 extent;      //Half size for boxes; the radius in x for circles
+    };
+
+    void castRay(const b2World& world, std::size_t i);
+    void overlapRegion(const b2World& world, const BodyGrid* grid, std::size_t i);
+
+    std::vector<RayQuery> rayQueries;
+    std::vector<RayHit> rayHits;
+    std::vector<RegionQuery> regionQueries;
+    std::vector<std::vector<ex::Entity::Id>> regionScratch;    //Per region, filled in parallel
+    std::vector<ex::Entity::Id> regionHits;                     //All regions' entities, in order
+    std::vector<std::size_t> regionOffsets;                     //Region i is [offsets[i], offsets[i+1])
+};
+
+#endif // SDL2D3_QUERIES_H
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "utility/decompose.h"
+#include "utility/strings.h"
+#include "utility/utility.h"
+#include "utility/trace.h"
+#include "shapeasset.h"
+
+namespace {
+
+//Points used to approximate circle parts as light occluders
+const std::size_t circleOutlinePoints = 15;
+
+sf::ConvexShape outline(const Polygon& points)
+{
+    sf::ConvexShape shape(points.size());
+    for(std::size_t i = 0; i != points.size(); ++i)
+        shape.setPoint(i, points[i]);
+    return shape;
+}
+
+//Whether b2PolygonShape::Set keeps a polygon after welding close vertices, using
+//Box2D 2.3's own tolerance. It asserts on anything left with under 3 vertices or no area
+bool survivesWelding(const std::vector<b2Vec2>& vertices)
+{
+    std::vector<b2Vec2> welded;
+    for(const b2Vec2& v : vertices) {
+        bool unique = std::none_of(welded.begin(), welded.end(), [&](const b2Vec2& w) {
+            return b2DistanceSquared(v, w) < 0.5f * b2_linearSlop;
+        });
+        if(unique)
+            welded.push_back(v);
+    }
+    if(welded.size() < 3)
+        return false;
+    float area = 0;
+    for(std::size_t i = 0; i != welded.size(); ++i)
+        area += b2Cross(welded[i], welded[(i + 1) % welded.size()]);
+    return std::abs(area / 2) > b2_linearSlop * b2_linearSlop;
+}
+
+//False if the polygon isn't simple
+bool addPolygon(ShapeAsset& asset, const Polygon& polygon)
+{
+    std::vector<Polygon> pieces;
+    if(!decomposeConvex(polygon, b2_maxPolygonVertices, pieces))
+        return false;
+    for(const Polygon& piece : pieces) {
+        std::vector<b2Vec2> vertices;
+        for(const sf::Vector2f& p : piece)
+            vertices.emplace_back(meters(p.x), meters(p.y));
+        if(!survivesWelding(vertices))
+            continue;
+        for(const b2Vec2& v : vertices)
+            asset.extent = std::max(asset.extent, v.Length());
+        asset.polygons.push_back(std::move(vertices));
+        asset.occluders.push_back(outline(piece));
+    }
+    return true;
+}
+
+void addCircle(ShapeAsset& asset, float x, float y, float radius)
+{
+    ShapeAsset::Circle circle;
+    circle.center.Set(meters(x), meters(y));
+    circle.radius = meters(radius);
+    asset.circles.push_back(circle);
+    asset.extent = std::max(asset.extent, circle.center.Length() + circle.radius);
+
+    Polygon points;
+    for(std::size_t i = 0; i != circleOutlinePoints; ++i) {
+        float angle = i * 2 * M_PI / circleOutlinePoints;
+        points.emplace_back(x + radius * std::cos(angle), y + radius * std::sin(angle));
+    }
+    asset.occluders.push_back(outline(points));
+}
+
+}
+
+std::shared_ptr<const ShapeAsset> ShapeLibrary::load(const std::string& path)
+{
+    TRACE_SCOPE("ShapeLibrary::load");
+    auto cached = assets.find(path);
+    if(cached != assets.end())
+        return cached->second;
+
+    std::ifstream file(path);
+    if(!file.is_open()) {
+        std::cerr << "ShapeLibrary: File " << path << " couldn't be found!" << std::endl;
+        return nullptr;
+    }
+
+    auto asset = std::make_shared<ShapeAsset>();
+    std::size_t slash = path.find_last_of("/\\");
+    asset->name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+    asset->name = asset->name.substr(0, asset->name.find('.'));
+    asset->extent = 0;
+
+    std::string line;
+    int lineNo = 0;
+    while(std::getline(file, line)) {
+        ++lineNo;
+        std::istringstream in(line.substr(0, line.find(';')));
+        std::string kind;
+        if(!(in >> kind))
+            continue;
+        if(kind == "polygon") {
+            Polygon polygon;
+            float x, y;
+            while(in >> x >> y)
+                polygon.emplace_back(x, y);
+            if(!addPolygon(*asset, polygon))
+                std::cerr << "ShapeLibrary: " << path << ":" << lineNo << ": polygon crosses itself" << std::endl;
+        } else if(kind == "circle") {
+            float x, y, radius;
+            if(in >> x >> y >> radius)
+                addCircle(*asset, x, y, radius);
+        } else {
+            std::cerr << "ShapeLibrary: " << path << ":" << lineNo << ": unknown part " << kind << std::endl;
+        }
+    }
+
+    if(asset->polygons.empty() && asset->circles.empty()) {
+        std::cerr << "ShapeLibrary: " << path << " has no usable parts" << std::endl;
+        return nullptr;
+    }
+    assets[path] = asset;
+    return asset;
+}
+
+std::vector<std::shared_ptr<const ShapeAsset>> ShapeLibrary::loadList(const std::string& colonpaths)
+{
+    std::vector<std::shared_ptr<const ShapeAsset>> result;
+    if(colonpaths.empty())
+        return result;
+    for(const std::string& path : strSplit(colonpaths, ":")) {
+        if(auto asset = load(path))
+            result.push_back(asset);
+    }
+    return result;
+}
@@ -0,0 +1,46 @@
+#ifndef SDL2D3_SHAPEASSET_H
+#define SDL2D3_SHAPEASSET_H
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Box2D/Box2D.h>
+#include <SFML/Graphics.hpp>
+
+/* A polygon or compound body loaded from a shape file. The file lists parts in
+ * pixels relative to the body origin, one per line (; starts a comment):
+ *     polygon x0 y0 x1 y1 x2 y2 ...    any simple polygon, concave is fine
+ *     circle  x y radius
+ * Polygons are decomposed into convex pieces Box2D accepts once, on load;
+ * spawns then reuse the pieces and the light occluder outlines as they are. */
+
+struct ShapeAsset
+{
+    struct Circle
+    {
+        b2Vec2 center;  //Meters
+        float radius;
+    };
+
+    std::string name;                           //File name without directory and extension
+    std::vector<std::vector<b2Vec2>> polygons;  //Convex, at most b2_maxPolygonVertices, meters
+    std::vector<Circle> circles;
+    std::vector<sf::ConvexShape> occluders;     //One outline per part, pixels
+    float extent;                               //Largest distance from the origin, meters
+};
+
+//Cache of loaded shape assets, keyed by path. Each file is decomposed only once
+class ShapeLibrary
+{
+public:
+    //The asset for a shape file, loading it on first use. nullptr if it couldn't be loaded
+    std::shared_ptr<const ShapeAsset> load(const std::string& path);
+
+    //Load a colon-delimited list of shape files, skipping any that fail
+    std::vector<std::shared_ptr<const ShapeAsset>> loadList(const std::string& colonpaths);
+
+private:
+    std::map<std::string, std::shared_ptr<const ShapeAsset>> assets;
+};
+
+#endif // SDL2D3_SHAPEASSET_H
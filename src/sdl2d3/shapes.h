@@ -0,0 +1,161 @@
+#ifndef SDL2D3_SHAPES_H
+#define SDL2D3_SHAPES_H
+#include <stdexcept>
+#include <Box2D/Box2D.h>
+#include <SFML/Graphics.hpp>
+#include "sdl2d3/components.h"
+#include "sdl2d3/shapeasset.h"
+#include "utility/config.h"
+#include "utility/utility.h"
+
+/* Compile-time description of each spawnable shape. Everything a system needs
+ * to know about a shape type lives in its ShapeTraits specialization; code
+ * dispatches on SpawnComponent::TYPE once with withShape() and is otherwise
+ * written against the traits, so a new shape is a new specialization here
+ * rather than another branch in every system.
+ *
+ * Each specialization provides:
+ *   textureBank, textures   The texture bank index and the config key filling it
+ *   extent(spawn)           Largest distance from the body origin, meters
+ *   fixtures(spawn, add)    Calls add(const b2Shape&) for each fixture of the body
+ *   occluders(spawn, add)   Calls add(const sf::ConvexShape&) for each light occluder, pixels */
+
+template<SpawnComponent::TYPE T>
+struct ShapeTraits;
+
+template<>
+struct ShapeTraits<SpawnComponent::BOX>
+{
+    static constexpr float halfwidth = conf::box_halfwidth;  //Meters
+    static constexpr int textureBank = 0;
+    static constexpr cfg::Key textures = cfg::BOX_TEXTURES;
+
+    static float extent(const SpawnComponent&)
+    {
+        return halfwidth;
+    }
+
+    template<typename F>
+    static void fixtures(const SpawnComponent&, F&& add)
+    {
+        b2PolygonShape shape;
+        shape.SetAsBox(halfwidth, halfwidth);
+        add(shape);
+    }
+
+    template<typename F>
+    static void occluders(const SpawnComponent&, F&& add)
+    {
+        constexpr float w = pixels(halfwidth * 2);
+        sf::ConvexShape shape(4);
+        shape.setPoint(0, {0, 0});
+        shape.setPoint(1, {0, w});
+        shape.setPoint(2, {w, w});
+        shape.setPoint(3, {w, 0});
+        shape.setOrigin({w/2, w/2});
+        add(shape);
+    }
+};
+
+template<>
+struct ShapeTraits<SpawnComponent::CIRCLE>
+{
+    static constexpr float halfwidth = conf::circle_radius;  //Meters
+    static constexpr int textureBank = 1;
+    static constexpr cfg::Key textures = cfg::BALL_TEXTURES;
+    static constexpr std::size_t outlinePoints = 15;
+
+    static float extent(const SpawnComponent&)
+    {
+        return halfwidth;
+    }
+
+    template<typename F>
+    static void fixtures(const SpawnComponent&, F&& add)
+    {
+        b2CircleShape shape;
+        shape.m_radius = halfwidth;
+        add(shape);
+    }
+
+    template<typename F>
+    static void occluders(const SpawnComponent&, F&& add)
+    {
+        //Create SFML circle shape and copy points out
+        constexpr float radius = pixels(halfwidth);
+        sf::CircleShape circle(radius, outlinePoints);
+        sf::ConvexShape shape(outlinePoints);
+        for(std::size_t i = 0; i != outlinePoints; ++i)
+            shape.setPoint(i, circle.getPoint(i));
+        shape.setOrigin(radius, radius);
+        add(shape);
+    }
+};
+
+//Polygons and compound bodies from a shape file; the data comes decomposed from the asset,
+//with pieces Box2D would weld away already dropped
+template<>
+struct ShapeTraits<SpawnComponent::POLYGON>
+{
+    static constexpr int textureBank = 2;
+    static constexpr cfg::Key textures = cfg::SHAPE_TEXTURES;
+
+    static float extent(const SpawnComponent& spawn)
+    {
+        return spawn.asset->extent;
+    }
+
+    template<typename F>
+    static void fixtures(const SpawnComponent& spawn, F&& add)
+    {
+        b2PolygonShape polygon;
+        for(const std::vector<b2Vec2>& piece : spawn.asset->polygons) {
+            polygon.Set(piece.data(), piece.size());
+            add(polygon);
+        }
+        b2CircleShape circle;
+        for(const ShapeAsset::Circle& part : spawn.asset->circles) {
+            circle.m_p = part.center;
+            circle.m_radius = part.radius;
+            add(circle);
+        }
+    }
+
+    template<typename F>
+    static void occluders(const SpawnComponent& spawn, F&& add)
+    {
+        for(const sf::ConvexShape& shape : spawn.asset->occluders)
+            add(shape);
+    }
+};
+
+//Number of texture banks used by ShapeTraits::textureBank
+static constexpr int shapeTextureBanks = 3;
+
+//Call f with the ShapeTraits of `type`; the only runtime switch on shape type
+template<typename F>
+auto withShape(SpawnComponent::TYPE type, F&& f) -> decltype(f(ShapeTraits<SpawnComponent::BOX>()))
+{
+    switch(type)
+    {
+    case SpawnComponent::BOX:
+        return f(ShapeTraits<SpawnComponent::BOX>());
+    case SpawnComponent::CIRCLE:
+        return f(ShapeTraits<SpawnComponent::CIRCLE>());
+    case SpawnComponent::POLYGON:
+        return f(ShapeTraits<SpawnComponent::POLYGON>());
+    default:
+        throw std::runtime_error("This Spawn type is not implemented");
+    }
+}
+
+//Call f with the ShapeTraits of every shape type
+template<typename F>
+void forEachShape(F&& f)
+{
+    f(ShapeTraits<SpawnComponent::BOX>());
+    f(ShapeTraits<SpawnComponent::CIRCLE>());
+    f(ShapeTraits<SpawnComponent::POLYGON>());
+}
+
+#endif // SDL2D3_SHAPES_H
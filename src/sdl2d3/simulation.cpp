@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cmath>
+#include <SFML/System/Clock.hpp>
+#include "utility/utility.h"
+#include "sdl2d3/components.h"
+#include "sdl2d3/systems/Box2DSystem.h"
+#include "simulation.h"
+
+void dropBodies(ex::EntityManager& entities, const sf::Vector2u& size, int count, unsigned seed)
+{
+    //Large counts start overlapped and push apart
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> jitter(-12.5f, 12.5f);
+    int columns = std::max(1, (int)(size.x / 50) - 2);
+    for(int i = 0; i != count; ++i) {
+        float x = 50 * (1 + i % columns) + 25;
+        float y = 50 + std::fmod(50.f * (i / columns), size.y / 2.f);
+        if(seed != 0) {
+            x += jitter(rng);
+            y += jitter(rng);
+        }
+        auto type = (i % 2) ? SpawnComponent::CIRCLE : SpawnComponent::BOX;
+        entities.create().assign<SpawnComponent>(meters(x), meters(y), type);
+    }
+}
+
+Simulation::Simulation(const Config& settings, const Level& level, unsigned seed)
+    : config(settings)
+    , jobs(0)
+    , size(config.getInt(cfg::WIDTH), config.getInt(cfg::HEIGHT))
+    , seedValue(seed)
+    , stepSum(0)
+    , stepMax(0)
+    , impacts(0)
+{
+    //Instances would all write the same metrics file, and nothing is rewound. Bodies
+    //may sleep, unlike in the window, so the awake count and settle time mean something
+    config.set(cfg::PHYSICS_METRICS_FILE, "");
+    config.set(cfg::HISTORY_ENABLED, "0");
+    systems.add<Box2DSystem>(size, entities, config, level, jobs, true);
+    systems.configure();
+    events.subscribe<PhysicsStatsEvent>(*this);
+    events.subscribe<ContactBatchEvent>(*this);
+}
+
+Simulation::Result Simulation::run(int frames, float dt)
+{
+    sf::Clock clock;
+    PhysicsEvent gravity(PhysicsEvent::GravityChange);
+    gravity.grav.Set(0, 10);
+    events.emit<PhysicsEvent>(gravity);
+    dropBodies(entities, size, config.getInt(cfg::OFFSCREEN_SPAWN), seedValue);
+
+    Result result = {};
+    result.settleTime = -1;
+    for(int frame = 0; frame != frames; ++frame) {
+        systems.update<Box2DSystem>(dt);
+        result.simulated += dt;
+        if(result.settleTime < 0) {
+            sample(result);
+            if(result.bodies != 0 && result.awake == 0)
+                result.settleTime = result.simulated;
+        }
+    }
+
+    sample(result);
+    result.frames = frames;
+    result.wallTime = clock.getElapsedTime().asMicroseconds() / 1000.f;
+    result.meanStep = frames ? stepSum / frames : 0;
+    result.maxStep = stepMax;
+    result.impacts = impacts;
+    return result;
+}
+
+void Simulation::sample(Result& result)
+{
+    //Only entities' bodies count; the walls and level never move
+    result.bodies = 0;
+    result.awake = 0;
+    result.kineticEnergy = 0;
+    ex::ComponentHandle<Box2DComponent> box;
+    for(ex::Entity e : entities.entities_with_components(box)) {
+        (void)e;
+        const b2Body* body = box->body;
+        b2Vec2 v = body->GetLinearVelocity();
+        float w = body->GetAngularVelocity();
+        ++result.bodies;
+        result.awake += body->IsAwake();
+        result.kineticEnergy += 0.5f * (body->GetMass() * b2Dot(v, v) + body->GetInertia() * w * w);
+    }
+}
+
+void Simulation::receive(const PhysicsStatsEvent& e)
+{
+    stepSum += e.stepTime;
+    stepMax = std::max(stepMax, e.stepTime);
+}
+
+void Simulation::receive(const ContactBatchEvent& e)
+{
+    for(std::size_t i = 0; i != e.count; ++i)
+        impacts += e.contacts[i].type == Contact::Impact;
+}
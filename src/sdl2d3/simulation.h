@@ -0,0 +1,68 @@
+#ifndef SDL2D3_SIMULATION_H
+#define SDL2D3_SIMULATION_H
+#include <random>
+#include <entityx/entityx.h>
+#include "utility/config.h"
+#include "utility/JobSystem.h"
+#include "sdl2d3/events.h"
+#include "sdl2d3/level.h"
+namespace ex = entityx;
+
+//Drop a grid of alternating boxes and balls, wrapping within the upper half of a
+//`size` pixel screen. A nonzero seed jitters each spawn point by up to half a cell
+void dropBodies(ex::EntityManager& entities, const sf::Vector2u& size, int count, unsigned seed = 0);
+
+/* One headless world for batch runs: an EntityX instance of its own with only a
+ * Box2DSystem (whose bodies, unlike the window's, may sleep), a private copy of
+ * the config and its own (inline) job system, so any number of them can step at
+ * once on different threads. The level is shared read-only. Construct instances
+ * on one thread, as Box2D sets up some shared tables the first time a world is
+ * made; only run() may be called concurrently.
+ *
+ * One known race remains: Box2D counts calls and iterations of its distance and
+ * time of impact routines in plain globals (b2_gjkCalls, b2_gjkIters, b2_toiCalls,
+ * b2_toiIters and the like), which worlds stepping at once all bump. Nothing in
+ * Box2D or here reads them, so the lost counts are harmless, but a thread
+ * sanitizer will report them. */
+
+class Simulation : public ex::EntityX, public ex::Receiver<Simulation>
+{
+public:
+    struct Result
+    {
+        int frames;
+        float simulated;        //!<Seconds
+        float wallTime;         //!<Milliseconds for the whole run
+        float meanStep, maxStep;//!<Milliseconds per frame in world->Step
+        int bodies;
+        int awake;              //!<Bodies still awake at the end, by Box2D's own sleep test
+        float kineticEnergy;    //!<At the end, joules
+        float settleTime;       //!<First time every body was asleep, seconds; -1 if never
+        long impacts;           //!<Impacts of at least CONTACT_IMPULSE_MIN over the run
+    };
+
+    //`config` is copied; set any swept keys on it first
+    Simulation(const Config& config, const Level& level, unsigned seed);
+
+    //Spawn OFFSCREEN_SPAWN bodies under gravity, then step `frames` frames of `dt` seconds
+    Result run(int frames, float dt = 1.f / 60);
+
+    unsigned seed() const { return seedValue; }
+
+    void receive(const PhysicsStatsEvent& e);
+    void receive(const ContactBatchEvent& e);
+
+private:
+    void sample(Result& result);
+
+    Config config;
+    JobSystem jobs;
+    sf::Vector2u size;
+    unsigned seedValue;
+
+    //Collected from events during run()
+    float stepSum, stepMax;
+    long impacts;
+};
+
+#endif // SDL2D3_SIMULATION_H
@@ -1,40 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 #include <memory>
 #include "utility/utility.h"
+#include "utility/view.h"
+#include "utility/trace.h"
 #include "sdl2d3/components.h"
+#include "sdl2d3/shapes.h"
 #include "Box2DSystem.h"
 
-Box2DSystem::Box2DSystem(sf::RenderWindow& rw)
-    : windowBody(nullptr)
-    , window(rw)
+Box2DSystem::Box2DSystem(sf::RenderTarget& rw, ex::EntityManager& entities, const Config& config, const Level& level,
+                         JobSystem& jobs)
+    : Box2DSystem(rw.getSize(), entities, config, level, jobs)
+{
+    //Setup Debug draw and link to world
+    window = &rw;
+    drawer.setWindow(rw);
+    drawer.SetFlags(b2Draw::e_shapeBit);
+    world->SetDebugDraw(&drawer);
+}
+
+Box2DSystem::Box2DSystem(const sf::Vector2u& size, ex::EntityManager& entities, const Config& config,
+                         const Level& level, JobSystem& jobs, bool sleeping)
+    : metricsFlushed(0)
+    , gridEnabled(false)
+    , gridDirty(true)
+    , historyEnabled(false)
+    , historyStale(false)
+    , paused(false)
+    , rewindFrame(-1)
+    , simulatedTime(0)
+    , contacts(config.getInt(cfg::CONTACT_BUFFER), config.getFloat(cfg::CONTACT_IMPULSE_MIN))
+    , windowBody(nullptr)
+    , window(nullptr)
+    , entities(entities)
+    , jobs(jobs)
+    , config(config)
     , debugEnabled(true)
     , windowCollisionEnabled(false)
+    , sleepingAllowed(sleeping)
+    , cheapSolver(false)
+    , maxSteps(config.getInt(cfg::TIME_MAX_STEPS))
 {
-    //Create world, initially 0 gravity
+    //Create world, initially 0 gravity, with the configured solver settings
     world = std::make_unique<b2World>(b2Vec2(0,0));
+    world->SetContactListener(&contacts);
+    loadSolverSettings();
+    loadBroadphase();
+    loadHistory();
 
     //Add static boxes to world to create walls around screen
-    addWallsOnScreen();
+    addWallsOnScreen(size);
+    addLevel(level);
 
-    //Setup Debug draw and link to world
-    drawer.setWindow(window);
-    drawer.SetFlags(b2Draw::e_shapeBit);
-    world->SetDebugDraw(&drawer);
+    openMetrics();
+}
+
+void Box2DSystem::update(ex::EntityManager&, ex::EventManager& events, ex::TimeDelta dt)
+{
+    TRACE_SCOPE("Box2DSystem::update");
+    advance(events, dt);
+    if(debugEnabled && window != nullptr) {
+        drawVisible();
+    }
 }
 
-void Box2DSystem::update(ex::EntityManager&, ex::EventManager&, ex::TimeDelta dt)
+void Box2DSystem::advance(ex::EventManager& events, float dt)
 {
+    TRACE_SCOPE("Box2DSystem::advance");
+    //Handle GUI events posted since the last frame
+    physicsEvents.drain([this](const PhysicsEvent& e) { handle(e); });
+    graphicsEvents.drain([this](const GraphicsEvent& e) { handle(e); });
+    if(!removalPoints.empty())
+        removeQueued();
+
     //If we have unspawned entites, create bodies in the world for them each
     for(ex::Entity e : unspawned)
         addToWorld(e);
     unspawned.clear();
 
-    //Step the world
-    const int32 velocityIterations = 8;
-    const int32 positionIterations = 5;
-    world->Step(dt, velocityIterations, positionIterations);
-    if(debugEnabled) {
-        world->DrawDebugData();
+    //Edited HISTORY_ keys; reloading ends a rewind, which can remove entities
+    bool historyReloaded = historyStale;
+    if(historyStale) {
+        loadHistory();
+        historyStale = false;
+    }
+
+    /* Fast forward covers more time than one step should, so it is cut into steps of
+     * about 1/60 s; a frame a little late isn't split. Past TIME_MAX_STEPS the rest is
+     * dropped and the simulation falls behind the time scale, rather than taking longer
+     * every frame to catch up */
+    const float longestStep = 1 / 60.f;
+    if(paused)
+        dt = 0;
+    int frames = paused ? 0 : std::max(1, (int)std::ceil(dt / longestStep - 0.25f));
+    if(frames > maxSteps) {
+        frames = maxSteps;
+        dt = maxSteps * longestStep;
+    }
+
+    //Step the world, split into substeps, and time it for the GUI readout.
+    //Box2D's profile only covers the last Step, so the phases are summed here
+    sf::Clock stepClock;
+    b2Profile profile = {};
+    int steps = frames * (cheapSolver ? 1 : substeps);
+    int32 velocity = cheapSolver ? std::max(1, velocityIterations / 2) : velocityIterations;
+    int32 position = cheapSolver ? std::max(1, positionIterations / 2) : positionIterations;
+    for(int i = 0; i != steps; ++i) {
+        TRACE_SCOPE("b2World::Step");
+        world->Step(dt / steps, velocity, position);
+        const b2Profile& last = world->GetProfile();
+        profile.step          += last.step;
+        profile.collide       += last.collide;
+        profile.solve         += last.solve;
+        profile.solveInit     += last.solveInit;
+        profile.solveVelocity += last.solveVelocity;
+        profile.solvePosition += last.solvePosition;
+        profile.broadphase    += last.broadphase;
+        profile.solveTOI      += last.solveTOI;
     }
+
+    gridDirty = true;
+    if(!paused) {
+        simulatedTime += dt;
+        if(historyEnabled) {
+            TRACE_SCOPE("WorldHistory::record");
+            history.record(*world, simulatedTime);
+        }
+    }
+
+    PhysicsStatsEvent stats = sampleStats(stepClock.getElapsedTime().asMicroseconds() / 1000.f, profile);
+    stats.simulated = dt;
+    stats.steps = frames;
+    stats.historyReloaded = historyReloaded;
+    writeMetrics(stats);
+
+    //Publish the contacts from every substep at once. Bodies destroyed since the last
+    //update added End contacts to this batch too
+    const std::vector<Contact>& recorded = contacts.contacts();
+    events.emit<ContactBatchEvent>(ContactBatchEvent{recorded.data(), recorded.size(), contacts.dropped()});
+    contacts.clear();
+    events.emit<PhysicsStatsEvent>(stats);
 }
 
 void Box2DSystem::configure(ex::EventManager& events)
@@ -43,25 +149,78 @@ void Box2DSystem::configure(ex::EventManager& events)
     events.subscribe<ex::EntityDestroyedEvent>(*this);
     events.subscribe<PhysicsEvent>(*this);
     events.subscribe<GraphicsEvent>(*this);
+    events.subscribe<ConfigEvent>(*this);
+    events.subscribe<QualityEvent>(*this);
 }
 
 void Box2DSystem::receive(const PhysicsEvent& e)
 {
+    physicsEvents.push(e);
+}
+
+void Box2DSystem::receive(const GraphicsEvent& e)
+{
+    graphicsEvents.push(e);
+}
+
+void Box2DSystem::handle(const PhysicsEvent& e)
+{
+    TRACE_SCOPE("Box2DSystem::handle(PhysicsEvent)");
     switch(e.type)
     {
     case PhysicsEvent::GravityChange:
         world->SetGravity(e.grav);
         break;
+    case PhysicsEvent::EntityRemoveReq:
+        removals.addCircle(e.pos, conf::circle_radius*2);
+        removalPoints.push_back(e.pos);
+        break;
     case PhysicsEvent::WindowCollision:
         windowCollisionEnabled = e.value;
         toggleWindowCollision();
         break;
+    case PhysicsEvent::VelocityIterations:
+        velocityIterations = e.count;
+        break;
+    case PhysicsEvent::PositionIterations:
+        positionIterations = e.count;
+        break;
+    case PhysicsEvent::Substeps:
+        substeps = std::max(1, e.count);
+        break;
+    case PhysicsEvent::Density:
+        density = e.amount;
+        updateMaterials();
+        break;
+    case PhysicsEvent::BoxRestitution:
+        boxRestitution = e.amount;
+        updateMaterials();
+        break;
+    case PhysicsEvent::CircleRestitution:
+        circleRestitution = e.amount;
+        updateMaterials();
+        break;
+    case PhysicsEvent::WarmStarting:
+        world->SetWarmStarting(e.value);
+        break;
+    case PhysicsEvent::ContinuousCollision:
+        world->SetContinuousPhysics(e.value);
+        break;
+    case PhysicsEvent::Pause:
+        if(e.value)
+            paused = true;
+        else
+            resume();
+        break;
+    case PhysicsEvent::HistorySeek:
+        seekHistory(e.amount);
+        break;
     default:
         break;
     }
 }
 
-void Box2DSystem::receive(const GraphicsEvent& e)
+void Box2DSystem::handle(const GraphicsEvent& e)
 {
     switch(e.type)
     {
@@ -70,6 +229,7 @@ void Box2DSystem::receive(const GraphicsEvent& e)
         break;
     case GraphicsEvent::ShowAAABs:
         drawer.SetFlags(drawer.GetFlags() ^ b2Draw::e_aabbBit);
+        staticLayer.invalidate();
         break;
     case GraphicsEvent::GuiWindowChange:
     	//TODO? Window collison like SDL2D2
@@ -83,6 +243,57 @@ void Box2DSystem::receive(const GraphicsEvent& e)
     }
 }
 
+void Box2DSystem::receive(const ConfigEvent& e)
+{
+    if(e.changed.test(cfg::PHYSICS_METRICS_FILE))
+        openMetrics();
+    if(e.changed.test(cfg::BROADPHASE))
+        loadBroadphase();
+    if(e.changed.test(cfg::TIME_MAX_STEPS))
+        maxSteps = config.getInt(cfg::TIME_MAX_STEPS);
+    for(cfg::Key key : {cfg::HISTORY_ENABLED, cfg::HISTORY_MEMORY_MB, cfg::HISTORY_RATE,
+                        cfg::HISTORY_POSITION_PRECISION, cfg::HISTORY_ANGLE_PRECISION,
+                        cfg::HISTORY_VELOCITY_PRECISION}) {
+        if(e.changed.test(key))
+            historyStale = true;
+    }
+    if(e.changed.test(cfg::CONTACT_BUFFER) || e.changed.test(cfg::CONTACT_IMPULSE_MIN))
+        contacts.setLimits(config.getInt(cfg::CONTACT_BUFFER), config.getFloat(cfg::CONTACT_IMPULSE_MIN));
+
+    //An edited BOX2D_ key replaces only its own setting; the others keep any GUI changes
+    if(e.changed.test(cfg::BOX2D_VELOCITY_ITERATIONS))
+        velocityIterations = config.getInt(cfg::BOX2D_VELOCITY_ITERATIONS);
+    if(e.changed.test(cfg::BOX2D_POSITION_ITERATIONS))
+        positionIterations = config.getInt(cfg::BOX2D_POSITION_ITERATIONS);
+    if(e.changed.test(cfg::BOX2D_SUBSTEPS))
+        substeps = config.getInt(cfg::BOX2D_SUBSTEPS);
+    if(e.changed.test(cfg::BOX2D_WARM_STARTING))
+        world->SetWarmStarting(config.getBool(cfg::BOX2D_WARM_STARTING));
+    if(e.changed.test(cfg::BOX2D_CONTINUOUS))
+        world->SetContinuousPhysics(config.getBool(cfg::BOX2D_CONTINUOUS));
+    bool materials = false;
+    if(e.changed.test(cfg::BOX2D_DENSITY)) {
+        density = config.getFloat(cfg::BOX2D_DENSITY);
+        materials = true;
+    }
+    if(e.changed.test(cfg::BOX2D_RESTITUTION)) {
+        boxRestitution = config.getFloat(cfg::BOX2D_RESTITUTION);
+        materials = true;
+    }
+    if(e.changed.test(cfg::BOX2D_CIRCLE_RESTITUTION)) {
+        circleRestitution = config.getFloat(cfg::BOX2D_CIRCLE_RESTITUTION);
+        materials = true;
+    }
+    if(materials)
+        updateMaterials();
+}
+
+void Box2DSystem::receive(const QualityEvent& e)
+{
+    //Applied at step time, so the configured and GUI settings are kept for when quality returns
+    cheapSolver = e.level >= QualityEvent::CheapPhysics;
+}
+
 void Box2DSystem::receive(const entityx::ComponentAddedEvent<SpawnComponent>& e)
 {
     //Event listener to add a Box2D component when an entity is spawned
@@ -93,25 +304,30 @@ void Box2DSystem::receive(const ex::EntityDestroyedEvent& e)
 {
     /* We only care if a Box2DComponent ent has been removed.
      * If one has, we remove it from the b2World. */
-    if(e.entity.has_component<Box2DComponent>())
+    if(e.entity.has_component<Box2DComponent>()) {
         world->DestroyBody(e.entity.component<const Box2DComponent>()->body);
+        gridDirty = true;
+    }
 }
 
 void Box2DSystem::addToWorld(ex::Entity e)
 {
+    TRACE_SCOPE("Box2DSystem::addToWorld");
     //Get the spawn info and add an actual b2Body to the world
     auto spawn = e.component<SpawnComponent>();
-    b2Body* body = createSpawnComponentBody(spawn->x, spawn->y, spawn->type, b2_dynamicBody);
+    b2Body* body = createSpawnComponentBody(*spawn, b2_dynamicBody);
 
-    //Store it in the EntityX system
+    //Store it in the EntityX system, and the entity in the body for contacts
+    setBodyEntity(body, e.id());
     e.assign<Box2DComponent>(body);
+    gridDirty = true;
 }
 
 void Box2DSystem::toggleWindowCollision()
 {
    if(windowCollisionEnabled) {
        world->DestroyBody(windowBody);
-       windowBody = createBody(0, 0, 100, 100, SpawnComponent::BOX, b2_dynamicBody);
+       windowBody = createDynamicBox(0, 0, 100, 100);
        windowBody->SetFixedRotation(true);
    } else {
         world->DestroyBody(windowBody);
@@ -119,10 +335,324 @@ void Box2DSystem::toggleWindowCollision()
    }
 }
 
-void Box2DSystem::addWallsOnScreen()
+void Box2DSystem::loadSolverSettings()
+{
+    velocityIterations = config.getInt(cfg::BOX2D_VELOCITY_ITERATIONS);
+    positionIterations = config.getInt(cfg::BOX2D_POSITION_ITERATIONS);
+    substeps           = config.getInt(cfg::BOX2D_SUBSTEPS);
+    density            = config.getFloat(cfg::BOX2D_DENSITY);
+    boxRestitution     = config.getFloat(cfg::BOX2D_RESTITUTION);
+    circleRestitution  = config.getFloat(cfg::BOX2D_CIRCLE_RESTITUTION);
+    world->SetWarmStarting(config.getBool(cfg::BOX2D_WARM_STARTING));
+    world->SetContinuousPhysics(config.getBool(cfg::BOX2D_CONTINUOUS));
+}
+
+PhysicsStatsEvent Box2DSystem::sampleStats(float stepTime, const b2Profile& profile) const
+{
+    PhysicsStatsEvent stats;
+    stats.stepTime    = stepTime;
+    stats.bodies      = world->GetBodyCount();
+    stats.contacts    = world->GetContactCount();
+    stats.proxies     = world->GetProxyCount();
+    stats.joints      = world->GetJointCount();
+    stats.treeHeight  = world->GetTreeHeight();
+    stats.treeBalance = world->GetTreeBalance();
+    stats.treeQuality = world->GetTreeQuality();
+    stats.profile     = profile;
+    stats.paused      = paused;
+    stats.historySeconds = history.frames() ? history.newest() - history.oldest() : 0;
+    stats.historyBytes   = history.bytes();
+    stats.rewound        = rewindFrame >= 0 ? history.newest() - history.timeOf(rewindFrame) : 0;
+    return stats;
+}
+
+void Box2DSystem::loadHistory()
+{
+    //A rewound world carries on from the record shown, as it may be dropped or cleared
+    bool keepPaused = paused;
+    resume();
+    paused = keepPaused;
+    historyEnabled = config.getBool(cfg::HISTORY_ENABLED);
+    WorldHistory::Precision precision = {config.getFloat(cfg::HISTORY_POSITION_PRECISION),
+                                         config.getFloat(cfg::HISTORY_ANGLE_PRECISION),
+                                         config.getFloat(cfg::HISTORY_VELOCITY_PRECISION)};
+    history.setLimits(std::size_t(config.getFloat(cfg::HISTORY_MEMORY_MB) * (1 << 20)),
+                      1.f / config.getInt(cfg::HISTORY_RATE), precision);
+    if(!historyEnabled)
+        history.clear();
+}
+
+void Box2DSystem::seekHistory(float position)
 {
-    float width  = meters(window.getSize().x);
-    float height = meters(window.getSize().y);
+    TRACE_SCOPE("Box2DSystem::seekHistory");
+    paused = true;
+    if(history.frames() == 0)
+        return;
+    double time = history.oldest() + position * (history.newest() - history.oldest());
+    rewindFrame = history.frameAt(time);
+    history.restore(rewindFrame, entities);
+    gridDirty = true;
+}
+
+void Box2DSystem::resume()
+{
+    /* Carry on from the record being shown. Bodies spawned after it are removed
+     * so the world is as it was then, but bodies destroyed since can't be brought
+     * back; anything spawned while paused is kept */
+    paused = false;
+    if(rewindFrame < 0)
+        return;
+    std::vector<ex::Entity::Id> gone;
+    history.truncate(rewindFrame, gone);
+    simulatedTime = history.timeOf(rewindFrame);
+    rewindFrame = -1;
+    for(ex::Entity::Id id : gone) {
+        if(entities.valid(id))
+            entities.destroy(id);
+    }
+}
+
+void Box2DSystem::openMetrics()
+{
+    metrics.close();
+    metrics.clear();
+    metricsFlushed = 0;
+    const std::string& path = config.getString(cfg::PHYSICS_METRICS_FILE);
+    if(path.empty())
+        return;
+    metrics.open(path);
+    if(!metrics.is_open()) {
+        std::cerr << "Box2DSystem: Couldn't write metrics to " << path << std::endl;
+        return;
+    }
+    metrics << "time_s,step_ms,bodies,contacts,proxies,joints,tree_height,tree_balance,tree_quality,"
+               "collide_ms,solve_ms,solve_init_ms,solve_velocity_ms,solve_position_ms,broadphase_ms,solve_toi_ms\n";
+    metricsClock.restart();
+}
+
+void Box2DSystem::writeMetrics(const PhysicsStatsEvent& stats)
+{
+    if(!metrics.is_open())
+        return;
+    const b2Profile& p = stats.profile;
+    float now = metricsClock.getElapsedTime().asSeconds();
+    metrics << now << ',' << stats.stepTime << ','
+            << stats.bodies << ',' << stats.contacts << ',' << stats.proxies << ',' << stats.joints << ','
+            << stats.treeHeight << ',' << stats.treeBalance << ',' << stats.treeQuality << ','
+            << p.collide << ',' << p.solve << ',' << p.solveInit << ',' << p.solveVelocity << ','
+            << p.solvePosition << ',' << p.broadphase << ',' << p.solveTOI << '\n';
+
+    //Flush about once a second so the file can be followed while running
+    if(now - metricsFlushed >= 1) {
+        metrics.flush();
+        metricsFlushed = now;
+    }
+}
+
+void Box2DSystem::updateMaterials()
+{
+    TRACE_SCOPE("Box2DSystem::updateMaterials");
+    //Apply the current density and restitution to every existing dynamic body
+    for(b2Body* body = world->GetBodyList(); body != nullptr; body = body->GetNext()) {
+        if(body->GetType() != b2_dynamicBody)
+            continue;
+        for(b2Fixture* fix = body->GetFixtureList(); fix != nullptr; fix = fix->GetNext()) {
+            bool circle = fix->GetShape()->GetType() == b2Shape::e_circle;
+            fix->SetDensity(density);
+            fix->SetRestitution(circle ? circleRestitution : boxRestitution);
+        }
+        body->ResetMassData();
+    }
+}
+
+namespace {
+
+//Collects every fixture whose proxy overlaps a query box
+class FixtureCollector : public b2QueryCallback
+{
+public:
+    FixtureCollector(std::vector<b2Fixture*>& out) : out(out) { }
+    bool ReportFixture(b2Fixture* fixture) override
+    {
+        out.push_back(fixture);
+        return true;
+    }
+private:
+    std::vector<b2Fixture*>& out;
+};
+
+b2Color fixtureColor(const b2Body* body)
+{
+    //Same colors b2World::DrawDebugData uses
+    if(!body->IsActive())
+        return b2Color(0.5f, 0.5f, 0.3f);
+    if(body->GetType() == b2_staticBody)
+        return b2Color(0.5f, 0.9f, 0.5f);
+    if(body->GetType() == b2_kinematicBody)
+        return b2Color(0.5f, 0.5f, 0.9f);
+    if(!body->IsAwake())
+        return b2Color(0.6f, 0.6f, 0.6f);
+    return b2Color(0.9f, 0.7f, 0.7f);
+}
+
+//Same lines b2World::DrawJoint draws
+void drawJoint(b2Draw& draw, const b2Joint* joint)
+{
+    b2Vec2 x1 = joint->GetBodyA()->GetPosition();
+    b2Vec2 x2 = joint->GetBodyB()->GetPosition();
+    b2Vec2 p1 = joint->GetAnchorA();
+    b2Vec2 p2 = joint->GetAnchorB();
+    b2Color color(0.5f, 0.8f, 0.8f);
+    switch(joint->GetType())
+    {
+    case e_distanceJoint:
+        draw.DrawSegment(p1, p2, color);
+        break;
+    case e_pulleyJoint: {
+        const b2PulleyJoint* pulley = static_cast<const b2PulleyJoint*>(joint);
+        b2Vec2 s1 = pulley->GetGroundAnchorA();
+        b2Vec2 s2 = pulley->GetGroundAnchorB();
+        draw.DrawSegment(s1, p1, color);
+        draw.DrawSegment(s2, p2, color);
+        draw.DrawSegment(s1, s2, color);
+        break;
+    }
+    case e_mouseJoint:
+        break;
+    default:
+        draw.DrawSegment(x1, p1, color);
+        draw.DrawSegment(p1, p2, color);
+        draw.DrawSegment(x2, p2, color);
+        break;
+    }
+}
+
+}
+
+void Box2DSystem::removeQueued()
+{
+    /* All of a frame's middle clicks are answered in one batch. Of the entities
+     * near each click, the one whose body contains it is removed, or failing that
+     * the one whose center is nearest, if within the click's radius */
+    runQueries(removals);
+    const float radius = conf::circle_radius*2;
+    for(std::size_t i = 0; i != removalPoints.size(); ++i) {
+        const b2Vec2& point = removalPoints[i];
+        ex::Entity picked;
+        float best = radius;
+        for(ex::Entity::Id id : removals.region(i)) {
+            if(!entities.valid(id))
+                continue;
+            ex::Entity e = entities.get(id);
+            if(!e.has_component<Box2DComponent>())
+                continue;
+            const b2Body* body = e.component<Box2DComponent>()->body;
+            float distance = b2Distance(point, body->GetPosition());
+            for(const b2Fixture* f = body->GetFixtureList(); f != nullptr; f = f->GetNext()) {
+                if(f->TestPoint(point))
+                    distance = 0;
+            }
+            if(distance < best) {
+                best = distance;
+                picked = e;
+            }
+        }
+        if(picked.valid())
+            picked.destroy();
+    }
+    removals.clear();
+    removalPoints.clear();
+}
+
+const BodyGrid* Box2DSystem::queryGrid()
+{
+    if(!gridEnabled)
+        return nullptr;
+    if(gridDirty) {
+        TRACE_SCOPE("BodyGrid::rebuild");
+        bodyGrid.rebuild(*world);
+        gridDirty = false;
+    }
+    return &bodyGrid;
+}
+
+void Box2DSystem::loadBroadphase()
+{
+    const std::string& mode = config.getString(cfg::BROADPHASE);
+    if(mode != "tree" && mode != "grid")
+        std::cerr << "Box2DSystem: Unknown BROADPHASE \"" << mode << "\", using tree" << std::endl;
+    gridEnabled = (mode == "grid");
+    gridDirty = true;
+}
+
+void Box2DSystem::drawVisible()
+{
+    TRACE_SCOPE("Box2DSystem::drawVisible");
+    /* Ask the broadphase for fixtures in the view instead of drawing the whole
+     * world, so the cost follows what is on screen. A chain reports once per
+     * overlapping edge, hence the sort and unique */
+    sf::FloatRect view = viewBounds(window->getView());
+    b2AABB aabb;
+    aabb.lowerBound.Set(meters(view.left), meters(view.top));
+    aabb.upperBound.Set(meters(view.left + view.width), meters(view.top + view.height));
+
+    visibleFixtures.clear();
+    FixtureCollector collector(visibleFixtures);
+    world->QueryAABB(&collector, aabb);
+    std::sort(visibleFixtures.begin(), visibleFixtures.end());
+    visibleFixtures.erase(std::unique(visibleFixtures.begin(), visibleFixtures.end()), visibleFixtures.end());
+
+    //Static fixtures only when the cached layer is stale, then everything that moves
+    staticLayer.draw(*window, [&](sf::RenderTarget& target) {
+        drawer.setWindow(target);
+        for(const b2Fixture* fixture : visibleFixtures) {
+            if(fixture->GetBody()->GetType() == b2_staticBody)
+                drawFixture(fixture);
+        }
+        drawer.setWindow(*window);
+    });
+    for(const b2Fixture* fixture : visibleFixtures) {
+        if(fixture->GetBody()->GetType() != b2_staticBody)
+            drawFixture(fixture);
+    }
+
+    //Joints are few and drawn whole; centers of mass only for the bodies in view
+    uint32 flags = drawer.GetFlags();
+    if(flags & b2Draw::e_jointBit) {
+        for(const b2Joint* joint = world->GetJointList(); joint != nullptr; joint = joint->GetNext())
+            drawJoint(drawer, joint);
+    }
+    if(flags & b2Draw::e_centerOfMassBit) {
+        std::vector<const b2Body*> bodies;
+        for(const b2Fixture* fixture : visibleFixtures)
+            bodies.push_back(fixture->GetBody());
+        std::sort(bodies.begin(), bodies.end());
+        bodies.erase(std::unique(bodies.begin(), bodies.end()), bodies.end());
+        for(const b2Body* body : bodies) {
+            b2Transform xf = body->GetTransform();
+            xf.p = body->GetWorldCenter();
+            drawer.DrawTransform(xf);
+        }
+    }
+}
+
+void Box2DSystem::drawFixture(const b2Fixture* fixture)
+{
+    drawer.DrawFixture(fixture, fixtureColor(fixture->GetBody()));
+    if(drawer.GetFlags() & b2Draw::e_aabbBit) {
+        for(int32 i = 0; i != fixture->GetShape()->GetChildCount(); ++i) {
+            const b2AABB& box = fixture->GetAABB(i);
+            b2Vec2 vertices[4] = {box.lowerBound, {box.upperBound.x, box.lowerBound.y},
+                                  box.upperBound, {box.lowerBound.x, box.upperBound.y}};
+            drawer.DrawPolygon(vertices, 4, b2Color(0.9f, 0.3f, 0.9f));
+        }
+    }
+}
+
+void Box2DSystem::addWallsOnScreen(const sf::Vector2u& size)
+{
+    float width  = meters(size.x);
+    float height = meters(size.y);
     float halfwidth  = width  / 2;
     float halfheight = height / 2;
     const float wallsz = 15_px;
@@ -132,52 +662,68 @@ void Box2DSystem::addWallsOnScreen()
     createStaticBox(halfwidth, height-wallsz, halfwidth, wallsz); //Bottom wall
 }
 
+void Box2DSystem::addLevel(const Level& level)
+{
+    /* The whole level is one static body with a chain loop per outline, so the
+     * broadphase sees a few long edges rather than a box per tile, and bodies
+     * slide across tile seams without catching on internal corners */
+    if(level.empty())
+        return;
+    b2Body* body = createBody(0, 0, b2_staticBody);
+    std::vector<b2Vec2> vertices;
+    for(const std::vector<sf::Vector2f>& outline : level.outlines()) {
+        vertices.clear();
+        for(const sf::Vector2f& point : outline)
+            vertices.emplace_back(meters(point.x), meters(point.y));
+        b2ChainShape chain;
+        chain.CreateLoop(vertices.data(), vertices.size());
+        addFixture(body, chain);
+    }
+}
+
 b2Body* Box2DSystem::createStaticBox(float x, float y, float halfwidth, float halfheight)
 {
-    return createBody(x, y, halfwidth, halfheight, SpawnComponent::BOX, b2_staticBody);
+    b2PolygonShape shape;
+    shape.SetAsBox(halfwidth, halfheight);
+    b2Body* body = createBody(x, y, b2_staticBody);
+    addFixture(body, shape);
+    return body;
 }
 
 b2Body* Box2DSystem::createDynamicBox(float x, float y, float halfwidth, float halfheight)
 {
-    return createBody(x, y, halfwidth, halfheight, SpawnComponent::BOX, b2_dynamicBody);
+    b2PolygonShape shape;
+    shape.SetAsBox(halfwidth, halfheight);
+    b2Body* body = createBody(x, y, b2_dynamicBody);
+    addFixture(body, shape);
+    return body;
 }
 
-b2Body* Box2DSystem::createSpawnComponentBody(float x, float y, SpawnComponent::TYPE type, b2BodyType btype)
+b2Body* Box2DSystem::createSpawnComponentBody(const SpawnComponent& spawn, b2BodyType btype)
 {
-    float width = (type == SpawnComponent::BOX) ? conf::box_halfwidth : conf::circle_radius;
-    return createBody(x, y, width, width, type, btype);
+    //The shape's traits say which fixtures make up the body
+    b2Body* body = createBody(spawn.x, spawn.y, btype);
+    withShape(spawn.type, [&](auto traits) {
+        decltype(traits)::fixtures(spawn, [&](const b2Shape& shape) { addFixture(body, shape); });
+    });
+    return body;
 }
 
-b2Body* Box2DSystem::createBody(float x, float y, float wx, float wy, SpawnComponent::TYPE type, b2BodyType btype)
+b2Body* Box2DSystem::createBody(float x, float y, b2BodyType btype)
 {
-    b2Body*   body;
     b2BodyDef bodyDef;
-    b2FixtureDef fix;
-    b2PolygonShape poly;    //Two shapes for fixtures. Must remain in scope until CreateFixture
-    b2CircleShape circle;    
     bodyDef.type = btype;
     bodyDef.position.Set(x,y);
-    fix.density = (btype == b2_dynamicBody) ? 1.0 : 0.0;
-    fix.restitution = 0.3;
-    body = world->CreateBody(&bodyDef);
-
-    if(type == SpawnComponent::BOX) {
-        poly.SetAsBox(wx, wy);
-        fix.shape = &poly;
-    }
-    else if(type == SpawnComponent::CIRCLE) {
-        circle.m_radius = wx;
-        fix.restitution = 1;
-        fix.shape = &circle;
-    }
-    else {
-        throw std::runtime_error("This Spawn type is not implemented");
-    }
-
-    body->CreateFixture(&fix);
-    body->SetSleepingAllowed(false);
-
+    b2Body* body = world->CreateBody(&bodyDef);
+    body->SetSleepingAllowed(sleepingAllowed);
     return body;
 }
 
-
+void Box2DSystem::addFixture(b2Body* body, const b2Shape& shape)
+{
+    b2FixtureDef fix;
+    fix.shape = &shape;
+    fix.density = (body->GetType() == b2_dynamicBody) ? density : 0.0;
+    fix.restitution = (shape.GetType() == b2Shape::e_circle) ? circleRestitution : boxRestitution;
+    body->CreateFixture(&fix);
+}
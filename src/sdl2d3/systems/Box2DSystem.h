@@ -1,12 +1,19 @@
 #ifndef SDL2D3_BOX2D_SYSTEM_H
 #define SDL2D3_BOX2D_SYSTEM_H
+#include <fstream>
 #include <SFML/Graphics.hpp>
 #include <entityx/entityx.h>
 #include <Box2D/Box2D.h>
 #include "sdl2d3/events.h"
 #include "sdl2d3/components.h"
+#include "sdl2d3/contacts.h"
+#include "sdl2d3/history.h"
+#include "sdl2d3/level.h"
+#include "sdl2d3/queries.h"
 #include "utility/SFMLDebugDraw.h"
-#include "utility/keyvalues.h"
+#include "utility/config.h"
+#include "utility/EventQueue.h"
+#include "utility/StaticLayer.h"
 namespace ex = entityx;
 
 /* The Box2D System is to manage the Box2D world and receive events from the GUI
@@ -16,42 +23,130 @@ namespace ex = entityx;
 class Box2DSystem : public entityx::System<Box2DSystem>, public entityx::Receiver<Box2DSystem>
 {
 public:
-    //Initizlize with a RenderWindow so we can create walls around it
-    Box2DSystem(sf::RenderWindow& rw);
+    //Initizlize with the render target (window or offscreen texture) so we can create walls around it,
+    //the config for the solver settings, and the level to build static terrain from
+    Box2DSystem(sf::RenderTarget& rw, ex::EntityManager& entities, const Config& config, const Level& level,
+                JobSystem& jobs);
+
+    //Headless, for batch runs; walls go around a screen of `size` pixels and nothing is drawn.
+    //With `sleeping`, resting bodies may sleep. Gravity changes don't wake sleeping bodies,
+    //so the interactive world keeps them all awake
+    Box2DSystem(const sf::Vector2u& size, ex::EntityManager& entities, const Config& config, const Level& level,
+                JobSystem& jobs, bool sleeping = false);
+
+    /** Queries. Bodies map back to entities through their user data, so these
+     *  return entities without searching the entity list **/
+    //Answer every ray and region query in `batch` on the job system
+    void runQueries(QueryBatch& batch) { batch.run(*world, queryGrid(), jobs); }
+
+    //Paused or rewound, as of the last update; the rest of the simulation stops too
+    bool isPaused() const { return paused; }
 
 public:
     /** EntityX Interfaces **/
     //Steps the Box2D world and draws shapes
     void update(ex::EntityManager&, ex::EventManager&, ex::TimeDelta dt) override;
 
+    //Steps the world by `dt` seconds of simulated time without drawing, for frames
+    //skipped in fast forward. Stats and contacts are published as for update()
+    void advance(ex::EventManager& events, float dt);
+
     //EntityX event listeners
     void configure(ex::EventManager& events) override;
     void receive(const entityx::ComponentAddedEvent<SpawnComponent>& e);
     void receive(const entityx::EntityDestroyedEvent& e);
     void receive(const PhysicsEvent& e);
     void receive(const GraphicsEvent& e);
+    void receive(const ConfigEvent& e);
+    void receive(const QualityEvent& e);
 
 private:
+    //GUI events are queued by receive() and handled at the start of update()
+    void handle(const PhysicsEvent& e);
+    void handle(const GraphicsEvent& e);
+    EventQueue<PhysicsEvent> physicsEvents;
+    EventQueue<GraphicsEvent> graphicsEvents;
+
+    //Middle click removals, queued by handle() and picked with one query batch
+    void removeQueued();
+    QueryBatch removals;
+    std::vector<b2Vec2> removalPoints;
+
     //Event listeners and handlers
     void addToWorld(ex::Entity e);
-    void addWallsOnScreen();
+    void addWallsOnScreen(const sf::Vector2u& size);
+    void addLevel(const Level& level);
     void toggleWindowCollision();
+    void updateMaterials();
+    void loadSolverSettings();
 
-    //Utility functions to create b2 bodies
+    //World statistics for the GUI, and streamed to PHYSICS_METRICS_FILE if set
+    PhysicsStatsEvent sampleStats(float stepTime, const b2Profile& profile) const;
+    void openMetrics();
+    void writeMetrics(const PhysicsStatsEvent& stats);
+    std::ofstream metrics;
+    sf::Clock metricsClock;     //Time since the file was opened, for the first column
+    float metricsFlushed;       //Clock seconds at the last flush
+
+    //BROADPHASE=grid; the grid is rebuilt on the first query after bodies move or change.
+    //Returns null when queries should use the world's tree
+    const BodyGrid* queryGrid();
+    void loadBroadphase();
+    BodyGrid bodyGrid;
+    bool gridEnabled;
+    bool gridDirty;
+
+    //Rewind history, recorded after each step. While paused nothing is stepped; a seek
+    //shows a recorded state, and resuming from it forgets the history after it.
+    //Config edits are applied at the start of the next advance(), like GUI events
+    void loadHistory();
+    void seekHistory(float position);
+    void resume();
+    WorldHistory history;
+    bool historyEnabled;
+    bool historyStale;
+    bool paused;
+    long rewindFrame;           //History record being shown, or -1
+    double simulatedTime;       //The history's clock
+
+    //Debug draw only the fixtures the broadphase finds inside the view.
+    //Static bodies are cached in a layer that is redrawn only when the view changes.
+    //Joints and centers of mass are drawn too when their b2Draw flags are set
+    void drawVisible();
+    void drawFixture(const b2Fixture* fixture);
+    std::vector<b2Fixture*> visibleFixtures;
+    StaticLayer staticLayer;
+
+    //Utility functions to create b2 bodies and give them fixtures
     b2Body* createStaticBox(float x, float y, float halfwidth, float halfheight);
     b2Body* createDynamicBox(float x, float y, float halfwidth, float halfheight);
-    b2Body* createDynamicCircle(float x, float y, int radius);
-    b2Body* createSpawnComponentBody(float x, float y, SpawnComponent::TYPE type, b2BodyType btype);
-    b2Body* createBody(float x, float y, float wx, float wy, SpawnComponent::TYPE type, b2BodyType btype);
+    b2Body* createSpawnComponentBody(const SpawnComponent& spawn, b2BodyType btype);
+    b2Body* createBody(float x, float y, b2BodyType btype);
+    void addFixture(b2Body* body, const b2Shape& shape);
 
     //World information and state data
     std::unique_ptr<b2World> world;     //The World.
+    ContactRecorder contacts;           //Filled during Step, published after it
     b2Body* windowBody;                 //Body for the SFGUI window
     std::list<ex::Entity> unspawned;    //Entities added by EntityX not yet given a b2Body
     SFMLDebugDraw drawer;               //DebugDraw instance
-    sf::RenderWindow& window;           //Reference to the render window
+    sf::RenderTarget* window;           //The render window or offscreen texture; null when headless
+    ex::EntityManager& entities;        //Query results and removal requests
+    JobSystem& jobs;                    //Batched queries run in parallel
+    const Config& config;               //Solver settings are reloaded from here
     bool debugEnabled;
     bool windowCollisionEnabled;
+    bool sleepingAllowed;               //Given to every body created
+
+    //Solver and material settings. Loaded from config, changed live from the GUI
+    int32 velocityIterations;
+    int32 positionIterations;
+    int substeps;
+    float density;
+    float boxRestitution;
+    float circleRestitution;
+    bool cheapSolver;           //Set by the quality governor; halves iterations, no substeps
+    int maxSteps;               //Most 1/60 s steps in one update, from TIME_MAX_STEPS
 };
 
 #endif
@@ -0,0 +1,62 @@
+#include "utility/trace.h"
+#include "GovernorSystem.h"
+
+GovernorSystem::GovernorSystem(const Config& config)
+    : config(config)
+    , current(QualityEvent::Full)
+    , average(0)
+    , sinceChange(0)
+{
+    loadSettings();
+}
+
+void GovernorSystem::loadSettings()
+{
+    enabled      = config.getBool(cfg::GOVERNOR_ENABLED);
+    budget       = config.getFloat(cfg::GOVERNOR_BUDGET_MS);
+    restoreRatio = config.getFloat(cfg::GOVERNOR_RESTORE_RATIO);
+    frames       = config.getInt(cfg::GOVERNOR_FRAMES);
+}
+
+void GovernorSystem::addSample(float ms)
+{
+    //Roughly the mean of the last `frames` samples, without keeping them
+    average += (ms - average) * (2.f / (frames + 1));
+}
+
+void GovernorSystem::update(ex::EntityManager&, ex::EventManager& events, ex::TimeDelta)
+{
+    TRACE_SCOPE("GovernorSystem::update");
+    if(!enabled) {
+        if(current != QualityEvent::Full)
+            change(events, QualityEvent::Full);
+        return;
+    }
+
+    //Give each level a full averaging period to show its effect before judging it
+    if(++sinceChange < frames)
+        return;
+    if(average > budget && current + 1 < QualityEvent::LEVEL_COUNT)
+        change(events, QualityEvent::LEVEL(current + 1));
+    else if(average < budget * restoreRatio && current > QualityEvent::Full)
+        change(events, QualityEvent::LEVEL(current - 1));
+}
+
+void GovernorSystem::change(ex::EventManager& events, QualityEvent::LEVEL level)
+{
+    current = level;
+    sinceChange = 0;
+    events.emit<QualityEvent>(QualityEvent{level, average});
+}
+
+void GovernorSystem::configure(ex::EventManager& events)
+{
+    events.subscribe<ConfigEvent>(*this);
+}
+
+void GovernorSystem::receive(const ConfigEvent& e)
+{
+    if(e.changed.test(cfg::GOVERNOR_ENABLED) || e.changed.test(cfg::GOVERNOR_BUDGET_MS) ||
+       e.changed.test(cfg::GOVERNOR_RESTORE_RATIO) || e.changed.test(cfg::GOVERNOR_FRAMES))
+        loadSettings();
+}
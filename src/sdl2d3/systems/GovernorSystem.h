@@ -0,0 +1,48 @@
+#ifndef SDL2D3_GOVERNOR_SYSTEM_H
+#define SDL2D3_GOVERNOR_SYSTEM_H
+
+#include <entityx/entityx.h>
+#include "utility/config.h"
+#include "sdl2d3/events.h"
+namespace ex = entityx;
+
+/* The governor holds a frame-time budget by trading quality for time. It is
+ * fed the time the other systems spent each frame, and when the average stays
+ * over budget it steps the quality level down, emitting a QualityEvent the
+ * other systems act on. Quality is stepped back up only once the average is
+ * well under budget, so the level doesn't flip back and forth at the edge */
+
+class GovernorSystem : public ex::System<GovernorSystem>, public ex::Receiver<GovernorSystem>
+{
+public:
+    GovernorSystem(const Config& config);
+
+    //Milliseconds of work in the frame just done, excluding waits for display
+    void addSample(float ms);
+
+    QualityEvent::LEVEL level() const { return current; }
+
+public:
+    /** EntityX Interfaces **/
+    //Decides whether to change the quality level
+    void update(ex::EntityManager&, ex::EventManager& events, ex::TimeDelta) override;
+
+    void configure(ex::EventManager& events) override;
+    void receive(const ConfigEvent& e);
+
+private:
+    void loadSettings();
+    void change(ex::EventManager& events, QualityEvent::LEVEL level);
+
+    const Config& config;
+    bool enabled;
+    float budget;           //Target work per frame, ms
+    float restoreRatio;     //Fraction of the budget the average must be under to restore quality
+    int frames;             //Averaging period, and frames to wait after a change
+
+    QualityEvent::LEVEL current;
+    float average;          //Exponential moving average of the samples, ms
+    int sinceChange;        //Frames since the level last changed
+};
+
+#endif // SDL2D3_GOVERNOR_SYSTEM_H
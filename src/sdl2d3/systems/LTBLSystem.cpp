@@ -1,51 +1,100 @@
 #include <array>
 #include "utility/utility.h"
+#include "utility/trace.h"
+#include "utility/view.h"
 #include "sdl2d3/components.h"
+#include "sdl2d3/shapes.h"
 #include "LTBLSystem.h"
 #include "Box2DSystem.h"
 
-LTBLSystem::LTBLSystem(sf::RenderWindow& rw, entityx::EntityManager& entities, KeyValue& keys)
-    : lighingEnabled(true)
+namespace {
+
+//Drop every other point of a detailed outline. A convex shape stays convex
+void simplify(sf::ConvexShape& shape)
+{
+    std::size_t count = shape.getPointCount();
+    if(count <= 8)
+        return;
+    std::size_t kept = 0;
+    for(std::size_t i = 0; i < count; i += 2)
+        shape.setPoint(kept++, shape.getPoint(i));
+    shape.setPointCount(kept);
+}
+
+}
+
+LTBLSystem::LTBLSystem(sf::RenderTarget& rw, entityx::EntityManager& entities, const Config& config, const Level& level,
+                       JobSystem& jobs)
+    : particleLightsShown(0)
+    , mousePosition(rw.getSize().x / 2, rw.getSize().y / 2)
+    , lighingEnabled(true)
     , lightingMouseEnabled(true)
+    , simpleOccluders(false)
+    , lightScale(1)
     , window(rw)
     , entities(entities)
-    , keys(keys)
+    , config(config)
+    , level(level)
+    , jobs(jobs)
 {
     loadSetupLightSystem();
 }
 
 void LTBLSystem::loadSetupLightSystem()
 {
+    TRACE_SCOPE("LTBLSystem::loadSetupLightSystem");
     //Loads textures and shaders
     loadTextures();
+    createLightSystem();
+}
 
-    //Initialize the light system
+void LTBLSystem::createLightSystem()
+{
+    //Initialize the light system, at a fraction of the target's resolution if the governor asks
+    sf::Vector2u size = window.getSize();
+    sf::Vector2u imageSize(size.x * lightScale, size.y * lightScale);
+    //Occluders of the old light system go with it
+    std::vector<ex::Entity> stale;
+    ex::ComponentHandle<LTBLComponent> light;
+    for(ex::Entity e : entities.entities_with_components(light))
+        stale.push_back(e);
+    for(ex::Entity e : stale)
+        e.remove<LTBLComponent>();
     ls = std::make_unique<ltbl::LightSystem>();
-    ls->create({0,0,9999,9999}, window.getSize(), penumbraTexture, unshadowShader, lightOverShapeShader);
+    ls->create({0,0,9999,9999}, imageSize, penumbraTexture, unshadowShader, lightOverShapeShader);
     ls->_directionEmissionRange = 200;
     ls->_directionEmissionRadiusMultiplier = 0.3;
     ls->_ambientColor = {100,100,100};
 
-    //Create and setup the mouse light
-    ls->removeLight(mouselight);
+    //Create and setup the mouse light. A rebuild keeps its color and size
+    if(!mouselight)
+        mouselight = std::make_shared<ltbl::LightPointEmission>();
     sf::Vector2u texsize { pointLightTexture.getSize() };
-    mouselight = std::make_shared<ltbl::LightPointEmission>();
     mouselight->_emissionSprite.setOrigin((float)texsize.x * 0.5, (float)texsize.y * 0.5);
     mouselight->_emissionSprite.setTexture(pointLightTexture);
-    ls->addLight(mouselight);
+    if(lightingMouseEnabled)
+        ls->addLight(mouselight);
+    particleLightsShown = 0;
+
+    //The new light system needs the level's and entities' occluders again, this
+    //frame's spawns included, so nothing is left waiting to be added twice
+    bakeLevel();
+    for(ex::Entity e : entities.entities_with_components<SpawnComponent>())
+        addToWorld(e);
+    unspawned.clear();
 }
 
 void LTBLSystem::loadTextures()
 {
     //Load shaders and create objects
-    std::string    ushadowPath = keys.GetString("LIGHT_UNSHADOW_SHADER");
-    std::string overShaderPath = keys.GetString("LIGHT_OVER_SHADER");
+    std::string    ushadowPath = config.getString(cfg::LIGHT_UNSHADOW_SHADER);
+    std::string overShaderPath = config.getString(cfg::LIGHT_OVER_SHADER);
     unshadowShader.loadFromFile(ushadowPath + ".vert", ushadowPath + ".frag");
     lightOverShapeShader.loadFromFile(overShaderPath + ".vert", overShaderPath + ".frag");
 
     //Load and create the penumbra and point light textures
-    std::string prenumbraPath  = keys.GetString("LIGHT_PRENUMBRA_TEXTURE");
-    std::string pointLightPath = keys.GetString("LIGHT_POINT_TEXTURE");
+    std::string prenumbraPath  = config.getString(cfg::LIGHT_PRENUMBRA_TEXTURE);
+    std::string pointLightPath = config.getString(cfg::LIGHT_POINT_TEXTURE);
     penumbraTexture.loadFromFile(prenumbraPath);
     pointLightTexture.loadFromFile(pointLightPath);
     penumbraTexture.setSmooth(true);
@@ -54,31 +103,43 @@ void LTBLSystem::loadTextures()
 
 void LTBLSystem::update(ex::EntityManager&, ex::EventManager&, ex::TimeDelta)
 {
+    TRACE_SCOPE("LTBLSystem::update");
+    //Handle GUI events posted since the last frame. A Reload rebuilds everything here
+    lightEvents.drain([this](const LightEvent& e) { handle(e); });
+    graphicsEvents.drain([this](const GraphicsEvent& e) { handle(e); });
+
     //If we have entities to place in the system, do it
     for(ex::Entity e : unspawned)
         addToWorld(e);
     unspawned.clear();
 
     if(lighingEnabled) {
-        //Take all Box2D components, and update the LTBL components
-        ex::ComponentHandle<Box2DComponent> box;
-        ex::ComponentHandle<LTBLComponent> light;
-        for(ex::Entity e : entities.entities_with_components(box, light)) {
-            (void)e;
-            sf::ConvexShape& s = light->light->_shape;
-            b2Vec2 position = box->body->GetPosition();
+        //Take all Box2D components, and update the LTBL components on the job threads
+        PixelMapper mapPixel(window);
+        lit.parallel_each(jobs, 256, [&](ex::Entity, Box2DComponent& box, LTBLComponent& light) {
+            b2Vec2 position = box.body->GetPosition();
             sf::Vector2f adjusted = {pixels(position.x), pixels(position.y)};
-            s.setPosition(window.mapPixelToCoords({(int)adjusted.x, (int)adjusted.y}));
-            s.setRotation(box->body->GetAngle() * (180.0 / M_PI));
-        }
+            sf::Vector2f mapped = mapPixel({(int)adjusted.x, (int)adjusted.y});
+            float rotation = box.body->GetAngle() * (180.0 / M_PI);
+            for(const auto& shape : light.lights) {
+                shape->_shape.setPosition(mapped);
+                shape->_shape.setRotation(rotation);
+            }
+        });
+        //Level shapes never move in the world, only when the view pans or zooms
+        const sf::View& view = window.getView();
+        if(view.getCenter() != levelView.getCenter() || view.getSize() != levelView.getSize())
+            placeLevel();
         //Update the mouse light's position
         if(lightingMouseEnabled) {
-            sf::Vector2f mouse = window.mapPixelToCoords(sf::Mouse::getPosition(window));
+            sf::Vector2f mouse = window.mapPixelToCoords(mousePosition);
             mouselight->_emissionSprite.setPosition(window.mapPixelToCoords({(int)mouse.x,(int)mouse.y}));
         }
+        placeParticleLights(mapPixel);
         //Render the lights
         ls->render(window.getView(), unshadowShader, lightOverShapeShader);
         sf::Sprite lighting(ls->getLightingTexture());
+        lighting.setScale(1 / lightScale, 1 / lightScale);
         window.draw(lighting, sf::BlendMultiply);
     }
 }
@@ -90,10 +151,95 @@ void LTBLSystem::configure(ex::EventManager& events)
     events.subscribe<sf::Event>(*this);
     events.subscribe<LightEvent>(*this);
     events.subscribe<GraphicsEvent>(*this);
+    events.subscribe<ConfigEvent>(*this);
+    events.subscribe<QualityEvent>(*this);
+    events.subscribe<ParticleLightsEvent>(*this);
+    lit.configure(entities, events);
 }
 
 void LTBLSystem::receive(const LightEvent& e)
 {
+    lightEvents.push(e);
+}
+
+void LTBLSystem::receive(const GraphicsEvent& e)
+{
+    graphicsEvents.push(e);
+}
+
+void LTBLSystem::receive(const ConfigEvent& e)
+{
+    //Edited shader or texture paths reload the light system, same as the GUI button
+    if(e.changed.test(cfg::LIGHT_OVER_SHADER) || e.changed.test(cfg::LIGHT_UNSHADOW_SHADER) ||
+       e.changed.test(cfg::LIGHT_PRENUMBRA_TEXTURE) || e.changed.test(cfg::LIGHT_POINT_TEXTURE)) {
+        lightEvents.push(LightEvent(LightEvent::Reload));
+    }
+}
+
+void LTBLSystem::receive(const QualityEvent& e)
+{
+    //A new resolution needs a new light system; simpler occluders only need new shapes
+    bool simple = e.level >= QualityEvent::SimpleOccluders;
+    float scale = (e.level >= QualityEvent::LowResLighting) ? 0.5f : 1.f;
+    if(scale != lightScale) {
+        lightScale = scale;
+        simpleOccluders = simple;
+        createLightSystem();
+    } else if(simple != simpleOccluders) {
+        simpleOccluders = simple;
+        rebuildOccluders();
+    }
+}
+
+void LTBLSystem::receive(const ParticleLightsEvent& e)
+{
+    //The arrays are only lent for the event, so keep a copy for update()
+    particleLightPositions.assign(e.positions, e.positions + e.count);
+    particleLightColors.assign(e.colors, e.colors + e.count);
+}
+
+void LTBLSystem::placeParticleLights(const PixelMapper& mapPixel)
+{
+    //Small, dim versions of the mouse light; made once and kept for reuse
+    std::size_t wanted = particleLightPositions.size();
+    while(particleLights.size() < wanted) {
+        auto light = std::make_shared<ltbl::LightPointEmission>();
+        sf::Vector2u texsize { pointLightTexture.getSize() };
+        light->_emissionSprite.setOrigin((float)texsize.x * 0.5, (float)texsize.y * 0.5);
+        light->_emissionSprite.setTexture(pointLightTexture);
+        light->_emissionSprite.setScale(0.1f, 0.1f);
+        light->_sourceRadius = 1;
+        particleLights.push_back(light);
+    }
+    for(; particleLightsShown < wanted; ++particleLightsShown)
+        ls->addLight(particleLights[particleLightsShown]);
+    for(; particleLightsShown > wanted; --particleLightsShown)
+        ls->removeLight(particleLights[particleLightsShown - 1]);
+
+    //Placed like the entity shapes, from world pixels through the view
+    for(std::size_t i = 0; i != wanted; ++i) {
+        const sf::Vector2f& position = particleLightPositions[i];
+        sf::Sprite& sprite = particleLights[i]->_emissionSprite;
+        sprite.setPosition(mapPixel({(int)position.x, (int)position.y}));
+        sprite.setColor(particleLightColors[i]);
+    }
+}
+
+void LTBLSystem::rebuildOccluders()
+{
+    TRACE_SCOPE("LTBLSystem::rebuildOccluders");
+    //addToWorld() replaces the component, so collect the entities first
+    std::vector<ex::Entity> occluded;
+    ex::ComponentHandle<LTBLComponent> light;
+    for(ex::Entity e : entities.entities_with_components(light))
+        occluded.push_back(e);
+    for(ex::Entity e : occluded)
+        addToWorld(e);
+}
+
+void LTBLSystem::handle(const LightEvent& e)
+{
+    TRACE_SCOPE("LTBLSystem::handle(LightEvent)");
     switch(e.type)
     {
     case LightEvent::Color:
@@ -103,6 +249,7 @@ void LTBLSystem::receive(const LightEvent& e)
         lighingEnabled = e.value;
         break;
     case LightEvent::MouseEnabled:
+        lightingMouseEnabled = e.value;
         if(e.value) {
             ls->addLight(mouselight);
         } else {
@@ -111,15 +258,13 @@ void LTBLSystem::receive(const LightEvent& e)
         break;
     case LightEvent::Reload:
         loadSetupLightSystem();
-        for(ex::Entity e : entities.entities_with_components<Box2DComponent>())
-            addToWorld(e);
         break;
     default:
         break;
     }
 }
 
-void LTBLSystem::receive(const GraphicsEvent& e)
+void LTBLSystem::handle(const GraphicsEvent& e)
 {
     switch(e.type)
     {
@@ -144,14 +289,21 @@ void LTBLSystem::receive(const ex::ComponentAddedEvent<SpawnComponent>& e)
 
 void LTBLSystem::receive(const ex::EntityDestroyedEvent& e)
 {
-    if(e.entity.has_component<LTBLComponent>())
-        ls->removeShape(e.entity.component<const LTBLComponent>()->light);
+    if(e.entity.has_component<LTBLComponent>()) {
+        for(const auto& shape : e.entity.component<const LTBLComponent>()->lights)
+            ls->removeShape(shape);
+    }
 }
 
 void LTBLSystem::receive(const sf::Event &e)
 {
     switch(e.type)
     {
+    case sf::Event::MouseMoved: {
+        //Tracked from events rather than sf::Mouse, which needs a window
+        mousePosition = {e.mouseMove.x, e.mouseMove.y};
+        break;
+    }
     case sf::Event::MouseWheelScrolled: {
         if(sf::Keyboard::isKeyPressed(sf::Keyboard::LControl)) {
             //Change size of light when scrolled and CTRL
@@ -169,58 +321,85 @@ void LTBLSystem::receive(const sf::Event &e)
 
 void LTBLSystem::addToWorld(ex::Entity e)
 {
-    //Create an initial light shape...
-    std::shared_ptr<ltbl::LightShape> lightShape = std::make_shared<ltbl::LightShape>();
-
-    //Use the SpawnComponent to create a light with the right body and x/y points
-    auto spawn = e.component<SpawnComponent>();
-
-    if(spawn->type == SpawnComponent::BOX) {
-        float w = pixels(conf::box_halfwidth * 2);
-        sf::ConvexShape& light = lightShape->_shape;
-        light.setPointCount(4);
-        light.setPoint(0, {0, 0});
-        light.setPoint(1, {0, w});
-        light.setPoint(2, {w, w});
-        light.setPoint(3, {w, 0});
-        light.setOrigin({w/2, w/2});
-    }
-    else if(spawn->type == SpawnComponent::CIRCLE) {
-        //Circle requested; create SFML circle shape and copy points out.
-        float radius = pixels(conf::circle_radius);
-        sf::CircleShape circle(radius, 15);
-        int nPoints = circle.getPointCount();
-        lightShape->_shape.setPointCount(nPoints);
-        for(int i = 0; i != nPoints; ++i)
-            lightShape->_shape.setPoint(i, circle.getPoint(i));
-        lightShape->_shape.setOrigin(radius, radius);
-    }
-    else {
-        throw std::runtime_error("Spawn type not recognized");
-    }
-
-    lightShape->_shape.setPosition(spawn->x, spawn->y);
-
-    //Accounts for window view. The light shape must be scaled to fit the Box2D size
+    TRACE_SCOPE("LTBLSystem::addToWorld");
+    //Accounts for window view. The light shapes must be scaled to fit the Box2D size
     sf::View nowView = window.getView();
     sf::View defView = window.getDefaultView();
     float zoom = nowView.getSize().x / defView.getSize().x;
-    lightShape->_shape.scale(zoom, zoom);
 
-    //Add a LTBL component to the entity, and add to light system
-    e.assign<LTBLComponent>(lightShape);
-    ls->addShape(lightShape);
+    //Use the SpawnComponent to create a light shape for each occluder of the body
+    auto spawn = e.component<SpawnComponent>();
+    std::vector<std::shared_ptr<ltbl::LightShape>> lights;
+    withShape(spawn->type, [&](auto traits) {
+        decltype(traits)::occluders(*spawn, [&](const sf::ConvexShape& outline) {
+            auto lightShape = std::make_shared<ltbl::LightShape>();
+            lightShape->_shape = outline;
+            if(simpleOccluders)
+                simplify(lightShape->_shape);
+            lightShape->_shape.setPosition(spawn->x, spawn->y);
+            lightShape->_shape.scale(zoom, zoom);
+            ls->addShape(lightShape);
+            lights.push_back(lightShape);
+        });
+    });
+
+    //Add a LTBL component to the entity, replacing any old one and its shapes
+    if(e.has_component<LTBLComponent>()) {
+        for(const auto& shape : e.component<LTBLComponent>()->lights)
+            ls->removeShape(shape);
+        e.remove<LTBLComponent>();
+    }
+    e.assign<LTBLComponent>(lights);
+}
+
+void LTBLSystem::bakeLevel()
+{
+    //One rectangle occluder per merged block of tiles, origin at its center like entity shapes
+    levelShapes.clear();
+    for(const sf::FloatRect& block : level.blocks()) {
+        auto lightShape = std::make_shared<ltbl::LightShape>();
+        lightShape->_shape.setPointCount(4);
+        lightShape->_shape.setPoint(0, {0, 0});
+        lightShape->_shape.setPoint(1, {0, block.height});
+        lightShape->_shape.setPoint(2, {block.width, block.height});
+        lightShape->_shape.setPoint(3, {block.width, 0});
+        lightShape->_shape.setOrigin(block.width / 2, block.height / 2);
+        ls->addShape(lightShape);
+        levelShapes.push_back(lightShape);
+    }
+    placeLevel();
+}
+
+void LTBLSystem::placeLevel()
+{
+    TRACE_SCOPE("LTBLSystem::placeLevel");
+    //Same view mapping and zoom scale that entity shapes get in update() and addToWorld()
+    levelView = window.getView();
+    float zoom = levelView.getSize().x / window.getDefaultView().getSize().x;
+    const std::vector<sf::FloatRect>& blocks = level.blocks();
+    for(std::size_t i = 0; i != levelShapes.size(); ++i) {
+        const sf::FloatRect& block = blocks[i];
+        sf::Vector2i center(block.left + block.width / 2, block.top + block.height / 2);
+        levelShapes[i]->_shape.setPosition(window.mapPixelToCoords(center));
+        levelShapes[i]->_shape.setScale(zoom, zoom);
+    }
 }
 
 void LTBLSystem::scaleAllEntities(float delta, bool absolute)
 {
-    ex::ComponentHandle<LTBLComponent> light;
-    for(ex::Entity e : entities.entities_with_components(light)) {
-        (void)e;
+    auto scale = [&](const std::shared_ptr<ltbl::LightShape>& shape) {
         if(absolute) {
-             light->light->_shape.setScale(delta, delta);
+             shape->_shape.setScale(delta, delta);
         } else {
-             light->light->_shape.scale(1.0 + delta, 1.0 + delta);
+             shape->_shape.scale(1.0 + delta, 1.0 + delta);
         }
+    };
+    ex::ComponentHandle<LTBLComponent> light;
+    for(ex::Entity e : entities.entities_with_components(light)) {
+        (void)e;
+        for(const auto& shape : light->lights)
+            scale(shape);
     }
+    for(const auto& shape : levelShapes)
+        scale(shape);
 }
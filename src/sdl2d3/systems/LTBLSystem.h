@@ -3,9 +3,13 @@
 
 #include <entityx/entityx.h>
 #include <ltbl/lighting/LightSystem.h>
-#include "utility/keyvalues.h"
+#include "utility/config.h"
+#include "utility/EventQueue.h"
+#include "utility/view.h"
 #include "sdl2d3/events.h"
 #include "sdl2d3/components.h"
+#include "sdl2d3/componentview.h"
+#include "sdl2d3/level.h"
 namespace ex = entityx;
 
 /* The Let There Be Light system creates a light system and updates it
@@ -16,8 +20,10 @@ namespace ex = entityx;
 class LTBLSystem : public ex::System<LTBLSystem>, public ex::Receiver<LTBLSystem>
 {
 public:
-    //Creates light system; Renderwindow and keyValue to load shaders and textures
-    LTBLSystem(sf::RenderWindow& rw, ex::EntityManager& entities, KeyValue& keys);
+    //Creates light system; Render target and config to load shaders and textures,
+    //and the level whose blocks become static occluders
+    LTBLSystem(sf::RenderTarget& rw, ex::EntityManager& entities, const Config& config, const Level& level,
+               JobSystem& jobs);
 
 public:
     /** EntityX Interfaces **/
@@ -32,14 +38,33 @@ public:
     void receive(const LightEvent& e);
     void receive(const GraphicsEvent& e);
     void receive(const sf::Event &e);
+    void receive(const ConfigEvent& e);
+    void receive(const QualityEvent& e);
+    void receive(const ParticleLightsEvent& e);
 
 private:
-    //Setup the entire light system and load textures
+    //GUI events are queued by receive() and handled at the start of update()
+    void handle(const LightEvent& e);
+    void handle(const GraphicsEvent& e);
+    EventQueue<LightEvent> lightEvents;
+    EventQueue<GraphicsEvent> graphicsEvents;
+
+    //Setup the entire light system and load textures. createLightSystem() only
+    //rebuilds the system and its shapes from the loaded textures
     void loadSetupLightSystem();
+    void createLightSystem();
     void loadTextures();
 
     //Add an entity to the light system (assuming a SpawnComponent is present)
     void addToWorld(ex::Entity e);
+    void rebuildOccluders();
+
+    //Level occluders are built once per light system and only moved when the view changes
+    void bakeLevel();
+    void placeLevel();
+
+    //Move the particle lights to the particles last published, adding or removing lights to match
+    void placeParticleLights(const PixelMapper& mapPixel);
 
     //Scale all light shapes by adding some delta. Absolute for setScale, not scale
     void scaleAllEntities(float delta, bool absolute = false);
@@ -53,13 +78,25 @@ private:
     std::shared_ptr<ltbl::LightPointEmission> mouselight;
     std::unique_ptr<ltbl::LightSystem> ls;
     std::list<ex::Entity> unspawned;
+    ComponentView<Box2DComponent, LTBLComponent> lit;  //Shapes moved each frame
+    std::vector<std::shared_ptr<ltbl::LightShape>> levelShapes;
+    std::vector<std::shared_ptr<ltbl::LightPointEmission>> particleLights;  //Pool; the first `particleLightsShown` are in `ls`
+    std::vector<sf::Vector2f> particleLightPositions;   //From the last ParticleLightsEvent, world pixels
+    std::vector<sf::Color> particleLightColors;
+    std::size_t particleLightsShown;
+    sf::View levelView;     //View the level shapes were last placed for
+    sf::Vector2i mousePosition;     //Last mouse position from events, pixels
     bool lighingEnabled;
     bool lightingMouseEnabled;
+    bool simpleOccluders;   //Quality governor settings
+    float lightScale;
 
-    //I/O devices (keys for textures, window for drawing)
-    sf::RenderWindow& window;
+    //I/O devices (config for textures, window or offscreen texture for drawing)
+    sf::RenderTarget& window;
     ex::EntityManager& entities;
-    KeyValue& keys;
+    const Config& config;
+    const Level& level;
+    JobSystem& jobs;        //Shape transforms are updated in parallel
 };
 
 #endif
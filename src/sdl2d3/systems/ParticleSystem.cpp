@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SDL2D3_PARTICLES_SSE
+#endif
+#include "utility/utility.h"
+#include "utility/trace.h"
+#include "ParticleSystem.h"
+
+namespace {
+
+const std::size_t grain = 4096;         //Particles per job; a multiple of four
+const float restitution = 0.4f;
+const float wallInset = 30;             //Thickness of the screen walls, pixels
+const float longestStep = 1 / 30.f;     //Longer steps throw particles through walls
+
+std::size_t roundUp4(std::size_t n)
+{
+    return (n + 3) & ~std::size_t(3);
+}
+
+}
+
+ParticleSystem::ParticleSystem(sf::RenderTarget& rw, ex::EntityManager& entities, const Config& config, const Level& level,
+                               JobSystem& jobs)
+    : solidColumns(0)
+    , solidRows(0)
+    , tileSize(config.getFloat(cfg::LEVEL_TILE_SIZE))
+    , count(0)
+    , capacity(0)
+    , gravity(0, 0)
+    , rng(1)
+    , window(rw)
+    , entities(entities)
+    , config(config)
+    , level(level)
+    , jobs(jobs)
+{
+    sf::Vector2u size = rw.getSize();
+    walls = {wallInset, wallInset, size.x - 2 * wallInset, size.y - 2 * wallInset};
+    bodyGrid.setCellSize(pixels(conf::circle_radius) * 2);
+    loadSettings();
+    buildSolidMap();
+}
+
+void ParticleSystem::loadSettings()
+{
+    //Growing or shrinking drops the particles past the new capacity
+    capacity = config.getInt(cfg::PARTICLE_MAX);
+    std::size_t padded = roundUp4(capacity);
+    for(std::vector<float>* array : {&px, &py, &vx, &vy, &life})
+        array->resize(padded, 0);
+    color.resize(padded);
+    count = std::min(count, capacity);
+
+    lifetime     = config.getFloat(cfg::PARTICLE_LIFETIME);
+    impactSparks = config.getInt(cfg::PARTICLE_IMPACT_SPARKS);
+    lights       = config.getInt(cfg::PARTICLE_LIGHTS);
+    maxTime      = config.getInt(cfg::TIME_MAX_STEPS) / 60.f;
+}
+
+void ParticleSystem::buildSolidMap()
+{
+    //The level only keeps merged blocks, so mark their tiles back into a bitmap
+    const std::vector<sf::FloatRect>& blocks = level.blocks();
+    if(blocks.empty())
+        return;
+    sf::Vector2i low(INT_MAX, INT_MAX), high(INT_MIN, INT_MIN);
+    for(const sf::FloatRect& block : blocks) {
+        low.x  = std::min(low.x,  (int)std::floor(block.left / tileSize));
+        low.y  = std::min(low.y,  (int)std::floor(block.top / tileSize));
+        high.x = std::max(high.x, (int)std::ceil((block.left + block.width) / tileSize));
+        high.y = std::max(high.y, (int)std::ceil((block.top + block.height) / tileSize));
+    }
+    solidOrigin = low;
+    solidColumns = high.x - low.x;
+    solidRows = high.y - low.y;
+    solidCells.assign(solidColumns * solidRows, 0);
+    for(const sf::FloatRect& block : blocks) {
+        int x0 = std::floor(block.left / tileSize) - low.x, x1 = std::ceil((block.left + block.width) / tileSize) - low.x;
+        int y0 = std::floor(block.top / tileSize) - low.y,  y1 = std::ceil((block.top + block.height) / tileSize) - low.y;
+        for(int y = y0; y != y1; ++y)
+            std::fill(&solidCells[y * solidColumns + x0], &solidCells[y * solidColumns + x1], 1);
+    }
+}
+
+bool ParticleSystem::solid(float x, float y) const
+{
+    int cx = (int)std::floor(x / tileSize) - solidOrigin.x;
+    int cy = (int)std::floor(y / tileSize) - solidOrigin.y;
+    if(cx < 0 || cy < 0 || cx >= solidColumns || cy >= solidRows)
+        return false;
+    return solidCells[cy * solidColumns + cx] != 0;
+}
+
+void ParticleSystem::spawn(const sf::Vector2f& position, int n, float speed, sf::Color tint)
+{
+    std::uniform_real_distribution<float> angle(0, 2 * M_PI);
+    std::uniform_real_distribution<float> fraction(0.2f, 1.f);
+    std::uniform_real_distribution<float> jitter(-2.f, 2.f);
+    n = std::min<std::size_t>(n, capacity - count);
+    for(int i = 0; i < n; ++i) {
+        float a = angle(rng), s = speed * fraction(rng);
+        std::size_t p = count++;
+        px[p] = position.x + jitter(rng);
+        py[p] = position.y + jitter(rng);
+        vx[p] = std::cos(a) * s;
+        vy[p] = std::sin(a) * s;
+        life[p] = lifetime * fraction(rng);
+        color[p] = tint;
+    }
+}
+
+void ParticleSystem::update(ex::EntityManager&, ex::EventManager& events, ex::TimeDelta dt)
+{
+    TRACE_SCOPE("ParticleSystem::update");
+    advance(dt);
+    publishLights(events);
+    if(count == 0)
+        return;
+
+    //Fade out over the last second of life
+    vertices.resize(count);
+    jobs.parallel_for(count, grain, [&](std::size_t begin, std::size_t end) {
+        for(std::size_t i = begin; i != end; ++i) {
+            sf::Color c = color[i];
+            c.a = std::min(1.f, life[i]) * 255;
+            vertices[i] = sf::Vertex({px[i], py[i]}, c);
+        }
+    });
+    window.draw(vertices.data(), count, sf::Points);
+}
+
+void ParticleSystem::advance(float dt)
+{
+    TRACE_SCOPE("ParticleSystem::advance");
+    /* Fast forward is cut into steps of at most 1/30 s, each job taking its
+     * particles through all of them. Like the Box2DSystem, time past TIME_MAX_STEPS
+     * worth of 1/60 s steps is dropped, which also covers a hitch or a breakpoint */
+    dt = std::min(dt, maxTime);
+    if(count == 0 || dt <= 0)
+        return;
+    int steps = std::max(1, (int)std::ceil(dt / longestStep));
+    float step = dt / steps;
+
+    fileBodies();
+    jobs.parallel_for(count, grain, [&](std::size_t begin, std::size_t end) {
+        for(int i = 0; i != steps; ++i) {
+            integrate(begin, end, step);
+            collide(begin, end, step);
+        }
+    });
+    removeDead();
+}
+
+void ParticleSystem::integrate(std::size_t begin, std::size_t end, float dt)
+{
+    /* Semi-implicit Euler with a little air drag. Padding past `count` is
+     * integrated along with the last group of four; it is never read */
+    float damping = 1 / (1 + dt * 0.5f);
+    end = roundUp4(end);
+    std::size_t i = begin;
+#ifdef SDL2D3_PARTICLES_SSE
+    __m128 step = _mm_set1_ps(dt);
+    __m128 drag = _mm_set1_ps(damping);
+    __m128 gx = _mm_set1_ps(gravity.x * dt);
+    __m128 gy = _mm_set1_ps(gravity.y * dt);
+    for(; i != end; i += 4) {
+        __m128 x = _mm_loadu_ps(&px[i]), y = _mm_loadu_ps(&py[i]);
+        __m128 u = _mm_loadu_ps(&vx[i]), v = _mm_loadu_ps(&vy[i]);
+        u = _mm_mul_ps(_mm_add_ps(u, gx), drag);
+        v = _mm_mul_ps(_mm_add_ps(v, gy), drag);
+        _mm_storeu_ps(&vx[i], u);
+        _mm_storeu_ps(&vy[i], v);
+        _mm_storeu_ps(&px[i], _mm_add_ps(x, _mm_mul_ps(u, step)));
+        _mm_storeu_ps(&py[i], _mm_add_ps(y, _mm_mul_ps(v, step)));
+        _mm_storeu_ps(&life[i], _mm_sub_ps(_mm_loadu_ps(&life[i]), step));
+    }
+#endif
+    for(; i != end; ++i) {
+        vx[i] = (vx[i] + gravity.x * dt) * damping;
+        vy[i] = (vy[i] + gravity.y * dt) * damping;
+        px[i] += vx[i] * dt;
+        py[i] += vy[i] * dt;
+        life[i] -= dt;
+    }
+}
+
+void ParticleSystem::collide(std::size_t begin, std::size_t end, float dt)
+{
+    for(std::size_t i = begin; i != end; ++i) {
+        float& x = px[i];
+        float& y = py[i];
+        float& u = vx[i];
+        float& v = vy[i];
+
+        //Level tiles: step back along whichever axis left the tile, and bounce on it
+        if(solid(x, y)) {
+            float lastX = x - u * dt, lastY = y - v * dt;
+            if(!solid(lastX, y)) {
+                x = lastX;
+                u = -u * restitution;
+            } else if(!solid(x, lastY)) {
+                y = lastY;
+                v = -v * restitution;
+            } else {
+                x = lastX;
+                y = lastY;
+                u = -u * restitution;
+                v = -v * restitution;
+            }
+        }
+
+        //Bodies: push out to the circle's edge and reflect the velocity relative to it
+        bodyGrid.query(x, y, x, y, [&](std::uint32_t index) {
+            const Circle& c = circles[index];
+            float dx = x - c.x, dy = y - c.y;
+            float distance2 = dx * dx + dy * dy;
+            if(distance2 >= c.radius * c.radius || distance2 == 0)
+                return;
+            float distance = std::sqrt(distance2);
+            float nx = dx / distance, ny = dy / distance;
+            x = c.x + nx * c.radius;
+            y = c.y + ny * c.radius;
+            float approach = (u - c.vx) * nx + (v - c.vy) * ny;
+            if(approach < 0) {
+                u -= (1 + restitution) * approach * nx;
+                v -= (1 + restitution) * approach * ny;
+            }
+        });
+
+        //Screen walls last, so nothing above pushes a particle off screen
+        if(x < walls.left) {
+            x = walls.left;
+            u = std::abs(u) * restitution;
+        } else if(x > walls.left + walls.width) {
+            x = walls.left + walls.width;
+            u = -std::abs(u) * restitution;
+        }
+        if(y < walls.top) {
+            y = walls.top;
+            v = std::abs(v) * restitution;
+        } else if(y > walls.top + walls.height) {
+            y = walls.top + walls.height;
+            v = -std::abs(v) * restitution;
+        }
+    }
+}
+
+void ParticleSystem::fileBodies()
+{
+    TRACE_SCOPE("ParticleSystem::fileBodies");
+    //Each body is a circle as wide as the narrow side of its bounding box
+    circles.clear();
+    bodyGrid.clear();
+    bodies.each([&](ex::Entity, Box2DComponent& box) {
+        const b2Body* body = box.body;
+        if(body->GetType() != b2_dynamicBody || body->GetFixtureList() == nullptr)
+            return;
+        b2AABB bounds = body->GetFixtureList()->GetAABB(0);
+        for(const b2Fixture* fixture = body->GetFixtureList()->GetNext(); fixture; fixture = fixture->GetNext())
+            bounds.Combine(fixture->GetAABB(0));
+        b2Vec2 extents = bounds.GetExtents();
+        b2Vec2 position = body->GetPosition();
+        b2Vec2 velocity = body->GetLinearVelocity();
+        Circle circle{pixels(position.x), pixels(position.y), pixels(std::min(extents.x, extents.y)),
+                      pixels(velocity.x), pixels(velocity.y)};
+        bodyGrid.add(circle.x, circle.y, circle.radius, circles.size());
+        circles.push_back(circle);
+    });
+    bodyGrid.build();
+}
+
+void ParticleSystem::removeDead()
+{
+    //Swap the last live particle into each gap; order doesn't matter
+    std::size_t i = 0;
+    while(i < count) {
+        if(life[i] > 0) {
+            ++i;
+            continue;
+        }
+        std::size_t last = --count;
+        px[i] = px[last];
+        py[i] = py[last];
+        vx[i] = vx[last];
+        vy[i] = vy[last];
+        life[i] = life[last];
+        color[i] = color[last];
+    }
+}
+
+void ParticleSystem::publishLights(ex::EventManager& events)
+{
+    //Evenly spaced particles, so a burst lights up as a whole rather than at one end
+    std::size_t n = std::min<std::size_t>(lights, count);
+    lightPositions.resize(n);
+    lightColors.resize(n);
+    for(std::size_t i = 0; i != n; ++i) {
+        std::size_t p = i * (count / n);
+        lightPositions[i] = {px[p], py[p]};
+        lightColors[i] = color[p];
+    }
+    events.emit<ParticleLightsEvent>(ParticleLightsEvent{lightPositions.data(), lightColors.data(), n});
+}
+
+void ParticleSystem::configure(ex::EventManager& events)
+{
+    events.subscribe<ParticleEvent>(*this);
+    events.subscribe<ContactBatchEvent>(*this);
+    events.subscribe<PhysicsEvent>(*this);
+    events.subscribe<ConfigEvent>(*this);
+    bodies.configure(entities, events);
+}
+
+void ParticleSystem::receive(const ParticleEvent& e)
+{
+    spawn(e.position, e.count, e.speed, e.color);
+}
+
+void ParticleSystem::receive(const ContactBatchEvent& e)
+{
+    //Sparks fly from hard impacts, faster the harder the hit
+    if(impactSparks <= 0)
+        return;
+    for(std::size_t i = 0; i != e.count && count < capacity; ++i) {
+        const Contact& contact = e.contacts[i];
+        if(contact.type != Contact::Impact)
+            continue;
+        sf::Vector2f point(pixels(contact.point.x), pixels(contact.point.y));
+        spawn(point, impactSparks, std::min(40 * contact.impulse, 400.f), {255, 200, 80});
+    }
+}
+
+void ParticleSystem::receive(const PhysicsEvent& e)
+{
+    if(e.type == PhysicsEvent::GravityChange)
+        gravity = {pixels(e.grav.x), pixels(e.grav.y)};
+}
+
+void ParticleSystem::receive(const ConfigEvent& e)
+{
+    if(e.changed.test(cfg::PARTICLE_MAX) || e.changed.test(cfg::PARTICLE_LIFETIME) ||
+       e.changed.test(cfg::PARTICLE_LIGHTS) || e.changed.test(cfg::PARTICLE_IMPACT_SPARKS) ||
+       e.changed.test(cfg::TIME_MAX_STEPS))
+        loadSettings();
+}
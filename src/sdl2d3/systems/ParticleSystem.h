@@ -0,0 +1,101 @@
+#ifndef SDL2D3_PARTICLE_SYSTEM_H
+#define SDL2D3_PARTICLE_SYSTEM_H
+
+#include <random>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include <entityx/entityx.h>
+#include "utility/config.h"
+#include "utility/JobSystem.h"
+#include "utility/SpatialGrid.h"
+#include "sdl2d3/events.h"
+#include "sdl2d3/components.h"
+#include "sdl2d3/componentview.h"
+#include "sdl2d3/level.h"
+namespace ex = entityx;
+
+/* Debris, sparks and the like, far more of them than could be Box2D bodies.
+ * Particles are points kept as parallel arrays (one per attribute) so the
+ * integration runs four at a time with SSE, spread over the job system. They
+ * bounce off the screen walls, the level's tiles and dynamic bodies (taken as
+ * circles), but don't push back. All of them are drawn in one vertex array,
+ * and a few of them, evenly picked, are given to the LTBLSystem as lights.
+ *
+ * Bursts come from ParticleEvents (the P key), and sparks from hard impacts
+ * in the Box2D contact stream. */
+
+class ParticleSystem : public ex::System<ParticleSystem>, public ex::Receiver<ParticleSystem>
+{
+public:
+    ParticleSystem(sf::RenderTarget& rw, ex::EntityManager& entities, const Config& config, const Level& level,
+                   JobSystem& jobs);
+
+public:
+    /** EntityX Interfaces **/
+    //Moves, collides and draws every particle
+    void update(ex::EntityManager& entities, ex::EventManager& events, ex::TimeDelta dt) override;
+
+    //Moves and collides every particle by `dt` seconds of simulated time without
+    //drawing, for frames skipped in fast forward
+    void advance(float dt);
+
+    void configure(ex::EventManager& events) override;
+    void receive(const ParticleEvent& e);
+    void receive(const ContactBatchEvent& e);
+    void receive(const PhysicsEvent& e);
+    void receive(const ConfigEvent& e);
+
+    std::size_t size() const { return count; }
+
+private:
+    void loadSettings();
+    void spawn(const sf::Vector2f& position, int n, float speed, sf::Color tint);
+
+    //Steps [begin, end), which starts on a multiple of four
+    void integrate(std::size_t begin, std::size_t end, float dt);
+    void collide(std::size_t begin, std::size_t end, float dt);
+    void removeDead();
+    void publishLights(ex::EventManager& events);
+
+    //Solid level tiles, to bounce off
+    void buildSolidMap();
+    bool solid(float x, float y) const;
+    std::vector<std::uint8_t> solidCells;
+    sf::Vector2i solidOrigin;       //Cell of solidCells[0]
+    int solidColumns, solidRows;
+    float tileSize;
+
+    //Dynamic bodies as circles, in pixels, refiled every frame
+    void fileBodies();
+    struct Circle { float x, y, radius, vx, vy; };
+    std::vector<Circle> circles;
+    SpatialGrid bodyGrid;
+    ComponentView<Box2DComponent> bodies;
+
+    //Particle storage; arrays are sized to the capacity rounded up to four
+    std::size_t count;
+    std::size_t capacity;
+    std::vector<float> px, py, vx, vy, life;
+    std::vector<sf::Color> color;
+
+    //Settings
+    float lifetime;
+    int impactSparks;
+    int lights;
+    float maxTime;                  //Most simulated seconds in one advance, from TIME_MAX_STEPS
+    sf::Vector2f gravity;           //Pixels per second squared
+    sf::FloatRect walls;            //Inside of the screen walls, pixels
+
+    std::vector<sf::Vertex> vertices;
+    std::vector<sf::Vector2f> lightPositions;
+    std::vector<sf::Color> lightColors;
+    std::minstd_rand rng;
+
+    sf::RenderTarget& window;
+    ex::EntityManager& entities;
+    const Config& config;
+    const Level& level;
+    JobSystem& jobs;
+};
+
+#endif // SDL2D3_PARTICLE_SYSTEM_H
@@ -1,21 +1,115 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
 #include <SFGUI/SFGUI.hpp>
 #include <SFGUI/Widgets.hpp>
 #include "utility/utility.h"
+#include "utility/trace.h"
 #include "sdl2d3/events.h"
 #include "sdl2d3/components.h"
 #include "Box2DSystem.h"
 #include "SFGUISystem.h"
 
-SFGUISystem::SFGUISystem(sf::RenderWindow& rw, ex::EntityManager& entities, ex::EventManager& events)
-    : window(rw)
+SFGUISystem::SFGUISystem(sf::RenderWindow& rw, ex::EntityManager& entities, ex::EventManager& events,
+                         const Config& config, ShapeLibrary& shapes)
+    : config(config)
+    , window(rw)
+    , shapes(shapes)
+    , lastStats()
+    , profileSum()
+    , stepTimeSum(0)
+    , simulatedSum(0)
+    , stepsSum(0)
+    , statsFrames(0)
+    , contactSums()
+    , contactsDropped(0)
+    , allocSums()
+    , profileFrames(0)
     , entities(entities)
     , events(events)
 {
+    parameters.setInterval(sf::milliseconds(config.getInt(cfg::GUI_PARAM_INTERVAL_MS)));
     createTheGUI();
+    loadShapeList();
+}
+
+void SFGUISystem::configure(ex::EventManager& events)
+{
+    events.subscribe<PhysicsStatsEvent>(*this);
+    events.subscribe<ContactBatchEvent>(*this);
+    events.subscribe<ProfileEvent>(*this);
+    events.subscribe<ConfigEvent>(*this);
+    events.subscribe<QualityEvent>(*this);
+}
+
+void SFGUISystem::receive(const ConfigEvent& e)
+{
+    if(e.changed.test(cfg::GUI_PARAM_INTERVAL_MS))
+        parameters.setInterval(sf::milliseconds(config.getInt(cfg::GUI_PARAM_INTERVAL_MS)));
+    if(e.changed.test(cfg::SHAPE_FILES))
+        loadShapeList();
+
+    //Setting the widgets publishes the new values through the usual events
+    for(const auto& spin : solverSpins) {
+        if(e.changed.test(spin.first))
+            spin.second->SetValue(config.getFloat(spin.first));
+    }
+    for(const auto& toggle : solverToggles) {
+        if(e.changed.test(toggle.first))
+            toggle.second->SetActive(config.getBool(toggle.first));
+    }
+}
+
+void SFGUISystem::receive(const PhysicsStatsEvent& e)
+{
+    lastStats = e;
+    stepTimeSum += e.stepTime;
+    simulatedSum += e.simulated;
+    stepsSum += e.steps;
+    profileSum.collide    += e.profile.collide;
+    profileSum.solve      += e.profile.solve;
+    profileSum.solveTOI   += e.profile.solveTOI;
+    profileSum.broadphase += e.profile.broadphase;
+    ++statsFrames;
+
+    //A config edit ended a rewind from the Box2DSystem's side; show the world as it is now
+    if(e.historyReloaded) {
+        pauseButton->SetActive(e.paused);
+        timeline->SetValue(1);
+    }
+}
+
+void SFGUISystem::receive(const ContactBatchEvent& e)
+{
+    for(std::size_t i = 0; i != e.count; ++i)
+        ++contactSums[e.contacts[i].type];
+    contactsDropped += e.dropped;
+}
+
+void SFGUISystem::receive(const ProfileEvent& e)
+{
+    for(int i = 0; i != alloc::TAG_COUNT; ++i) {
+        allocSums[i].allocations += e.tags[i].allocations;
+        allocSums[i].bytes += e.tags[i].bytes;
+        allocSums[i].live = e.tags[i].live;
+    }
+    ++profileFrames;
+}
+
+void SFGUISystem::receive(const QualityEvent& e)
+{
+    static const char* names[QualityEvent::LEVEL_COUNT] = {
+        "full", "no labels", "cheap physics", "simple occluders", "low-res lighting"
+    };
+    char buffer[96];
+    std::snprintf(buffer, sizeof(buffer), "Quality: %s (%.1f ms/frame)", names[e.level], e.frameTime);
+    qualityLabel->SetText(buffer);
 }
 
 void SFGUISystem::update(ex::EntityManager&, ex::EventManager&, ex::TimeDelta dt)
 {
+    TRACE_SCOPE("SFGUISystem::update");
     //Obligatory to draw with SFGUI
     window.resetGLStates();
 
@@ -44,12 +138,15 @@ void SFGUISystem::update(ex::EntityManager&, ex::EventManager&, ex::TimeDelta dt
         events.emit<sf::Event>(event);
     }
 
-    //Because sfg::Scale doesn't have good events
-    checkSliderEvents();
+    //Publish slider changes, throttled
+    parameters.flush();
 
     //Handle view movement with keys
     updateWindowView();
 
+    //Refresh the statistics labels if it's time
+    updateStatsReadout();
+
     //Updates and displays the GUI (also drawn last)
     gui_window->HandleEvent(event);
     gui_window->Update(dt);
@@ -66,8 +163,8 @@ void SFGUISystem::createTheGUI()
             .Connect(std::bind(&SFGUISystem::onWindowPosSizeChage, this));
     auto notebook = sfg::Notebook::Create();
 
-    //The Box2D setting widgets; a table
-    auto Box2DWidget = sfg::Table::Create();
+    //The Box2D setting widgets; gravity and solver tables, then the cost readout
+    auto Box2DWidget = sfg::Box::Create(sfg::Box::Orientation::VERTICAL);
     {
         //Widget layouts for table. {widget, {row,column,cspan,rspan}}
         static std::vector<std::pair<sfg::Widget::Ptr, sf::Rect<sf::Uint32>>> placement = {
@@ -78,14 +175,111 @@ void SFGUISystem::createTheGUI()
             {sfg::Button::Create("Zero Gravity"),{0,2,2,1}}
         };
         //Paces each element in the table with their layouts
+        auto gravityTable = sfg::Table::Create();
         for(const auto& entry : placement) {
-            Box2DWidget->Attach(entry.first, entry.second);
+            gravityTable->Attach(entry.first, entry.second);
         }
         //Save the slider widgets and register an event
         gravx = std::dynamic_pointer_cast<sfg::Scale>(placement[2].first);
         gravy = std::dynamic_pointer_cast<sfg::Scale>(placement[3].first);
         placement[4].first->GetSignal(sfg::Button::OnMouseLeftRelease)
             .Connect([&](){gravx->SetValue(0);gravy->SetValue(0);});
+        parameters.bind({gravx->GetAdjustment(), gravy->GetAdjustment()},
+                        std::bind(&SFGUISystem::publishGravity, this));
+
+        //Solver settings; one spin button per setting, initially from the config and
+        //limited to the range the config accepts for the key
+        struct SolverEntry {
+            const char* label;
+            float step;
+            int digits;
+            PhysicsEvent::TYPE type;
+            cfg::Key key;
+        };
+        static const SolverEntry solverEntries[] = {
+            {"Velocity iterations", 1,    0, PhysicsEvent::VelocityIterations, cfg::BOX2D_VELOCITY_ITERATIONS},
+            {"Position iterations", 1,    0, PhysicsEvent::PositionIterations, cfg::BOX2D_POSITION_ITERATIONS},
+            {"Substeps",            1,    0, PhysicsEvent::Substeps,           cfg::BOX2D_SUBSTEPS},
+            {"Density",             0.1,  2, PhysicsEvent::Density,            cfg::BOX2D_DENSITY},
+            {"Box restitution",     0.05, 2, PhysicsEvent::BoxRestitution,     cfg::BOX2D_RESTITUTION},
+            {"Ball restitution",    0.05, 2, PhysicsEvent::CircleRestitution,  cfg::BOX2D_CIRCLE_RESTITUTION}
+        };
+        auto solverTable = sfg::Table::Create();
+        sf::Uint32 row = 0;
+        for(const SolverEntry& entry : solverEntries) {
+            auto spin = sfg::SpinButton::Create(Config::minimum(entry.key), Config::maximum(entry.key), entry.step);
+            spin->SetDigits(entry.digits);
+            spin->SetValue(config.getFloat(entry.key));
+            spin->SetRequisition(sf::Vector2f(60.f, 0.f));
+            solverTable->Attach(sfg::Label::Create(entry.label), {0, row, 1, 1});
+            solverTable->Attach(spin, {1, row, 1, 1});
+            parameters.bind({spin->GetAdjustment()},
+                            std::bind(&SFGUISystem::publishSolverSetting, this, entry.type, spin->GetAdjustment(),
+                                      entry.digits == 0));
+            solverSpins.emplace_back(entry.key, spin);
+            ++row;
+        }
+
+        //Toggles for warm starting and continuous collision. The handlers hold the buttons
+        //weakly, as a button's own signal keeping it alive would never be freed
+        auto warmButton = sfg::CheckButton::Create("Warm starting");
+        auto continuousButton = sfg::CheckButton::Create("Continuous");
+        warmButton->SetActive(config.getBool(cfg::BOX2D_WARM_STARTING));
+        continuousButton->SetActive(config.getBool(cfg::BOX2D_CONTINUOUS));
+        warmButton->GetSignal(sfg::CheckButton::OnToggle)
+            .Connect(std::bind(&SFGUISystem::publishSolverToggle, this, PhysicsEvent::WarmStarting,
+                               std::weak_ptr<sfg::CheckButton>(warmButton)));
+        continuousButton->GetSignal(sfg::CheckButton::OnToggle)
+            .Connect(std::bind(&SFGUISystem::publishSolverToggle, this, PhysicsEvent::ContinuousCollision,
+                               std::weak_ptr<sfg::CheckButton>(continuousButton)));
+        solverToggles.emplace_back(cfg::BOX2D_WARM_STARTING, warmButton);
+        solverToggles.emplace_back(cfg::BOX2D_CONTINUOUS, continuousButton);
+        auto toggleBox = sfg::Box::Create();
+        toggleBox->Pack(warmButton);
+        toggleBox->Pack(continuousButton);
+
+        //Simulation speed: slow motion and fast forward, and frames stepped without drawing
+        auto timeTable = sfg::Table::Create();
+        auto scaleSpin = sfg::SpinButton::Create(Config::minimum(cfg::TIME_SCALE), Config::maximum(cfg::TIME_SCALE), 0.25);
+        auto skipSpin  = sfg::SpinButton::Create(Config::minimum(cfg::TIME_RENDER_SKIP),
+                                                 Config::maximum(cfg::TIME_RENDER_SKIP), 1);
+        scaleSpin->SetDigits(2);
+        scaleSpin->SetValue(config.getFloat(cfg::TIME_SCALE));
+        skipSpin->SetValue(config.getInt(cfg::TIME_RENDER_SKIP));
+        timeTable->Attach(sfg::Label::Create("Time scale"),   {0, 0, 1, 1});
+        timeTable->Attach(scaleSpin,                          {1, 0, 1, 1});
+        timeTable->Attach(sfg::Label::Create("Skip frames"),  {0, 1, 1, 1});
+        timeTable->Attach(skipSpin,                           {1, 1, 1, 1});
+        parameters.bind({scaleSpin->GetAdjustment()},
+                        std::bind(&SFGUISystem::publishTimeSetting, this, TimeEvent::Scale, scaleSpin->GetAdjustment()));
+        parameters.bind({skipSpin->GetAdjustment()},
+                        std::bind(&SFGUISystem::publishTimeSetting, this, TimeEvent::RenderSkip, skipSpin->GetAdjustment()));
+        solverSpins.emplace_back(cfg::TIME_SCALE, scaleSpin);
+        solverSpins.emplace_back(cfg::TIME_RENDER_SKIP, skipSpin);
+
+        //Rewind timeline, from the oldest recorded state on the left to the newest
+        auto historyBox = sfg::Box::Create();
+        pauseButton = sfg::CheckButton::Create("Pause");
+        timeline = sfg::Scale::Create(0, 1, 0.001);
+        timeline->SetValue(1);
+        timeline->SetRequisition(sf::Vector2f(160.f, 20.f));
+        pauseButton->GetSignal(sfg::CheckButton::OnToggle)
+            .Connect(std::bind(&SFGUISystem::publishPause, this));
+        parameters.bind({timeline->GetAdjustment()}, std::bind(&SFGUISystem::publishHistorySeek, this));
+        historyBox->Pack(pauseButton, false);
+        historyBox->Pack(timeline);
+
+        //Cost readout, filled in by updateStatsReadout()
+        physicsStats = sfg::Label::Create();
+        physicsStats->SetAlignment(sf::Vector2f(0.f, 0.f));
+
+        Box2DWidget->SetSpacing(8);
+        Box2DWidget->Pack(gravityTable);
+        Box2DWidget->Pack(solverTable);
+        Box2DWidget->Pack(toggleBox);
+        Box2DWidget->Pack(timeTable);
+        Box2DWidget->Pack(historyBox);
+        Box2DWidget->Pack(physicsStats);
     }
 
     //Let There Be Light settings widgets
@@ -99,6 +293,7 @@ void SFGUISystem::createTheGUI()
         for(int i = 0; i != 3; ++i) {
             auto labelbox = sfg::Box::Create(sfg::Box::Orientation::VERTICAL);
             sliders[i] = sfg::Scale::Create(0, 255, 1);
+            sliders[i]->SetValue(255);
             sliders[i]->SetRequisition( sf::Vector2f( 80.f, 20.f ) );
             labelbox->Pack(sfg::Label::Create(names[i]));
             labelbox->Pack(sliders[i]);
@@ -107,6 +302,8 @@ void SFGUISystem::createTheGUI()
         colorr = sliders[0];
         colorg = sliders[1];
         colorb = sliders[2];
+        parameters.bind({colorr->GetAdjustment(), colorg->GetAdjustment(), colorb->GetAdjustment()},
+                        std::bind(&SFGUISystem::publishLightColor, this));
         colorFrame->Add(sliderBox);
 
         //Misc buttons to control light, packed horizontally
@@ -156,6 +353,7 @@ void SFGUISystem::createTheGUI()
     //Add the two trees to the notebook
     notebook->AppendPage(Box2DWidget, sfg::Label::Create("Box2D"));
     notebook->AppendPage(LTBLWidget,  sfg::Label::Create("LTBL2"));
+    notebook->AppendPage(createProfilerPage(), sfg::Label::Create("Profiler"));
 
     //"Clear bodies" and "Reset View buttons
     auto clearButton = sfg::Button::Create("Clear Bodies");
@@ -166,11 +364,19 @@ void SFGUISystem::createTheGUI()
     miscBox->Pack(clearButton);
     miscBox->Pack(resetButton);
 
+    //Shape spawned with Shift + left click; filled in by loadShapeList()
+    shapeCombo = sfg::ComboBox::Create();
+    auto shapeBox = sfg::Box::Create();
+    shapeBox->SetSpacing(8);
+    shapeBox->Pack(sfg::Label::Create("Shift+click shape"), false);
+    shapeBox->Pack(shapeCombo);
+
     //Pack the notbook above the clear button and graphics boxes, and add to window
     auto final_box = sfg::Box::Create(sfg::Box::Orientation::VERTICAL);
     final_box->SetSpacing(8);
     final_box->Pack(notebook);
     final_box->Pack(miscBox);
+    final_box->Pack(shapeBox);
     final_box->Pack(graphicsFrame);
     gui_window->Add(final_box);
 }
@@ -194,6 +400,7 @@ void SFGUISystem::onMouseWheelScrolled(sf::Event::MouseWheelScrollEvent scroll)
 
 void SFGUISystem::onMouseClick(sf::Event::MouseButtonEvent click)
 {
+    TRACE_SCOPE("SFGUISystem::onMouseClick");
     //Do nothing if we have clicked inside the GUI window (uses global coordinates)
     if(gui_window->GetAllocation().contains(click.x, click.y))
         return;
@@ -204,40 +411,64 @@ void SFGUISystem::onMouseClick(sf::Event::MouseButtonEvent click)
     click.y = meters(adjusted.y);
 
     if(click.button == sf::Mouse::Button::Middle) {
-        /* On a middle click, we want to remove the closest entity to the click position.
-         * This is queried using the Box2D body information to distance to the click point */
-        b2Vec2 request(click.x, click.y);
-        auto candidates = entities.entities_with_components<Box2DComponent>();
-        ex::Entity e = *std::min_element(candidates.begin(), candidates.end(),
-            [request](ex::Entity a, ex::Entity b) {
-               b2Vec2 pos_a = a.component<Box2DComponent>()->body->GetPosition(),
-                      pos_b = b.component<Box2DComponent>()->body->GetPosition();
-               return b2Distance(pos_a, request) < b2Distance(pos_b, request);
-            });
-        if(e.valid()) {
-            b2Vec2 pos = e.component<Box2DComponent>()->body->GetPosition();
-            if(b2Distance(request, pos) < conf::circle_radius*2)
-                entities.destroy(e.id());
-        }
+        /* On a middle click, we want to remove the entity under or closest to the click.
+         * The Box2DSystem finds it with a world query at the start of its next update */
+        PhysicsEvent remove(PhysicsEvent::EntityRemoveReq);
+        remove.pos.Set(meters(adjusted.x), meters(adjusted.y));
+        events.emit<PhysicsEvent>(remove);
     } else {
-        /* On a left or right click, we want to spawn a
-         * new physics entity, either a box or a circle.  */
+        /* On a left or right click, we want to spawn a new physics entity,
+         * either a box or a circle, or the selected shape file with shift */
         SpawnComponent::TYPE type;
-        if(click.button == sf::Mouse::Button::Left) {
+        std::shared_ptr<const ShapeAsset> asset;
+        int selected = shapeCombo->GetSelectedItem();
+        bool shift = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift) ||
+                     sf::Keyboard::isKeyPressed(sf::Keyboard::RShift);
+        if(click.button == sf::Mouse::Button::Left && shift) {
+            if(selected == sfg::ComboBox::NONE || selected >= (int)shapeList.size())
+                return;
+            type = SpawnComponent::POLYGON;
+            asset = shapeList[selected];
+        } else if(click.button == sf::Mouse::Button::Left) {
             type = SpawnComponent::BOX;
-        } else if(sf::Mouse::Button::Right) {
+        } else if(click.button == sf::Mouse::Button::Right) {
             type = SpawnComponent::CIRCLE;
         } else {
-            //Do nothing
+            return;
         }
         ex::Entity e = entities.create();
-        e.assign<SpawnComponent>(click.x, click.y, type);
+        e.assign<SpawnComponent>(click.x, click.y, type, asset);
     }
 }
 
-void SFGUISystem::onKeyPressed(sf::Event::KeyEvent)
+void SFGUISystem::loadShapeList()
 {
+    TRACE_SCOPE("SFGUISystem::loadShapeList");
+    //Assets are cached by the library, so only new files are loaded and decomposed
+    shapeList = shapes.loadList(config.getString(cfg::SHAPE_FILES));
+    while(shapeCombo->GetItemCount() > 0)
+        shapeCombo->RemoveItem(0);
+    for(const auto& asset : shapeList)
+        shapeCombo->AppendItem(asset->name);
+    if(!shapeList.empty())
+        shapeCombo->SelectItem(0);
+}
 
+void SFGUISystem::onKeyPressed(sf::Event::KeyEvent key)
+{
+    //F12 writes the trace of the last few seconds, without stopping
+    if(key.code == sf::Keyboard::F12 && trace::enabled()) {
+        const std::string& path = config.getString(cfg::TRACE_FILE);
+        if(trace::write(path))
+            std::cout << "Trace written to " << path << std::endl;
+        else
+            std::cerr << "Trace: Couldn't write " << path << std::endl;
+    }
+    //P throws a burst of particles from the mouse
+    if(key.code == sf::Keyboard::P) {
+        sf::Vector2f position = window.mapPixelToCoords(sf::Mouse::getPosition(window));
+        events.emit<ParticleEvent>(ParticleEvent{position, config.getInt(cfg::PARTICLE_BURST), 300, {255, 160, 60}});
+    }
 }
 
 void SFGUISystem::updateWindowView()
@@ -271,26 +502,158 @@ void SFGUISystem::resetWindowView()
     window.setView(window.getDefaultView());
 }
 
-void SFGUISystem::checkSliderEvents()
+void SFGUISystem::publishGravity()
 {
-    /* Check for gravity updates from sliders. The "Zero Gravity" button
+    /* Called when a gravity slider changed. The "Zero Gravity" button
      * sets these sliders to 0, which causes this to occur as well */
-    sf::Vector2f newGrav { gravx->GetValue(), gravy->GetValue() };
-    if(newGrav != storedGrav) {
-        storedGrav = newGrav;
-        PhysicsEvent e(PhysicsEvent::GravityChange);
-        e.grav = b2Vec2(storedGrav.x, storedGrav.y);
-        events.emit<PhysicsEvent>(e);
+    PhysicsEvent e(PhysicsEvent::GravityChange);
+    e.grav = b2Vec2(gravx->GetValue(), gravy->GetValue());
+    events.emit<PhysicsEvent>(e);
+}
+
+void SFGUISystem::publishLightColor()
+{
+    //Called when one of the RGB light-color sliders changed
+    LightEvent e(LightEvent::Color);
+    e.color = {(sf::Uint8)colorr->GetValue(), (sf::Uint8)colorg->GetValue(), (sf::Uint8)colorb->GetValue()};
+    events.emit<LightEvent>(e);
+}
+
+void SFGUISystem::publishSolverSetting(PhysicsEvent::TYPE type, sfg::Adjustment::Ptr adjustment, bool integral)
+{
+    PhysicsEvent e(type);
+    if(integral) {
+        e.count = (int)std::lround(adjustment->GetValue());
+    } else {
+        e.amount = adjustment->GetValue();
+    }
+    events.emit<PhysicsEvent>(e);
+}
+
+void SFGUISystem::publishTimeSetting(TimeEvent::TYPE type, sfg::Adjustment::Ptr adjustment)
+{
+    TimeEvent e(type);
+    if(type == TimeEvent::Scale) {
+        e.scale = adjustment->GetValue();
+    } else {
+        e.frames = (int)std::lround(adjustment->GetValue());
+    }
+    events.emit<TimeEvent>(e);
+}
+
+void SFGUISystem::publishPause()
+{
+    //Resuming makes the point shown the newest, so the timeline goes back to the end
+    PhysicsEvent e(PhysicsEvent::Pause);
+    e.value = pauseButton->IsActive();
+    events.emit<PhysicsEvent>(e);
+    if(!e.value)
+        timeline->SetValue(1);
+}
+
+void SFGUISystem::publishHistorySeek()
+{
+    /* The end of the timeline is the live world. Moving there while it is already
+     * shown is publishPause() or a history reload putting the timeline back */
+    if(timeline->GetValue() >= 1 && (!pauseButton->IsActive() || lastStats.rewound == 0))
+        return;
+    if(!pauseButton->IsActive())
+        pauseButton->SetActive(true);
+    PhysicsEvent e(PhysicsEvent::HistorySeek);
+    e.amount = timeline->GetValue();
+    events.emit<PhysicsEvent>(e);
+}
+
+void SFGUISystem::publishSolverToggle(PhysicsEvent::TYPE type, std::weak_ptr<sfg::CheckButton> weak)
+{
+    sfg::CheckButton::Ptr button = weak.lock();
+    if(!button)
+        return;
+    PhysicsEvent e(type);
+    e.value = button->IsActive();
+    events.emit<PhysicsEvent>(e);
+}
+
+sfg::Widget::Ptr SFGUISystem::createProfilerPage()
+{
+    //The governor's current quality level sits above the allocation figures
+    auto box = sfg::Box::Create(sfg::Box::Orientation::VERTICAL);
+    box->SetSpacing(8);
+    qualityLabel = sfg::Label::Create("Quality: full");
+    box->Pack(qualityLabel, false);
+    if(!alloc::tracking) {
+        box->Pack(sfg::Label::Create("Allocation tracking is off.\nBuild with -DSDL2D3_TRACK_ALLOCATIONS=ON"));
+        return box;
+    }
+
+    //One row per subsystem; the labels are filled in by updateStatsReadout()
+    auto table = sfg::Table::Create();
+    table->SetColumnSpacings(12);
+    const char* headings[] = {"Allocs/frame", "KB/frame", "Live KB"};
+    for(int col = 0; col != 3; ++col)
+        table->Attach(sfg::Label::Create(headings[col]), {sf::Uint32(col + 1), 0, 1, 1});
+    for(int i = 0; i != alloc::TAG_COUNT; ++i) {
+        sf::Uint32 row = i + 1;
+        table->Attach(sfg::Label::Create(alloc::name(alloc::Tag(i))), {0, row, 1, 1});
+        for(int col = 0; col != 3; ++col) {
+            allocLabels[i][col] = sfg::Label::Create("-");
+            table->Attach(allocLabels[i][col], {sf::Uint32(col + 1), row, 1, 1});
+        }
     }
+    box->Pack(table);
+    return box;
+}
 
-    //Checks for changes in the RGB light-color sliders
-    sf::Color newColor {(sf::Uint8)colorr->GetValue(), (sf::Uint8)colorg->GetValue(), (sf::Uint8)colorb->GetValue()};
-    if(newColor != storedColor) {
-        storedColor = newColor;
-        LightEvent e(LightEvent::Color);
-        e.color = storedColor;
-        events.emit<LightEvent>(e);
+void SFGUISystem::updateStatsReadout()
+{
+    if(statsClock.getElapsedTime() < sf::milliseconds(250))
+        return;
+
+    char buffer[512];
+    if(statsFrames != 0) {
+        //Step phases say whether time goes to contacts, the solver, TOI or the tree
+        float n = statsFrames;
+        float wall = statsClock.getElapsedTime().asSeconds();
+        std::snprintf(buffer, sizeof(buffer),
+                      "Speed: %.2f sim s/s  Steps: %.1f /update\n"
+                      "Step: %.2f ms\n"
+                      "Collide %.2f  Solve %.2f  TOI %.2f  Broadphase %.2f\n"
+                      "Bodies: %d  Contacts: %d  Proxies: %d  Joints: %d\n"
+                      "Tree height: %d  Balance: %d  Quality: %.2f\n"
+                      "Begin %.1f  End %.1f  Impacts %.1f /frame  Dropped: %zu\n"
+                      "History: %.1f s  %.1f MB  Shown: -%.1f s",
+                      simulatedSum / wall, stepsSum / n,
+                      stepTimeSum / n,
+                      profileSum.collide / n, profileSum.solve / n, profileSum.solveTOI / n, profileSum.broadphase / n,
+                      lastStats.bodies, lastStats.contacts, lastStats.proxies, lastStats.joints,
+                      lastStats.treeHeight, lastStats.treeBalance, lastStats.treeQuality,
+                      contactSums[Contact::Begin] / n, contactSums[Contact::End] / n,
+                      contactSums[Contact::Impact] / n, contactsDropped,
+                      lastStats.historySeconds, lastStats.historyBytes / 1048576.f, lastStats.rewound);
+        physicsStats->SetText(buffer);
+        std::fill(std::begin(contactSums), std::end(contactSums), 0);
+        contactsDropped = 0;
+        stepTimeSum = 0;
+        simulatedSum = 0;
+        stepsSum = 0;
+        profileSum = b2Profile();
+        statsFrames = 0;
+    }
+
+    if(profileFrames != 0) {
+        for(int i = 0; i != alloc::TAG_COUNT; ++i) {
+            float values[3] = {(float)allocSums[i].allocations / profileFrames,
+                               allocSums[i].bytes / 1024.f / profileFrames,
+                               allocSums[i].live / 1024.f};
+            for(int col = 0; col != 3; ++col) {
+                std::snprintf(buffer, sizeof(buffer), "%.1f", values[col]);
+                allocLabels[i][col]->SetText(buffer);
+            }
+            allocSums[i] = {0, 0, 0};
+        }
+        profileFrames = 0;
     }
+    statsClock.restart();
 }
 
 void SFGUISystem::onWindowPosSizeChage()
@@ -6,35 +6,86 @@
 #include <SFML/Graphics.hpp>
 #include <entityx/entityx.h>
 #include "sdl2d3/events.h"
+#include "sdl2d3/parameters.h"
+#include "sdl2d3/shapeasset.h"
+#include "utility/config.h"
 namespace ex = entityx;
 
 /* The SFGUI system creates the GUI window, and emits all events to EntityX
  * as the user interacts with the entire game window. SFML events are polled
  * here, and the passed along to the rest of the system */
 
-class SFGUISystem : public ex::System<SFGUISystem>
+class SFGUISystem : public ex::System<SFGUISystem>, public ex::Receiver<SFGUISystem>
 {
 public:
-    SFGUISystem(sf::RenderWindow& rw, ex::EntityManager& entities, ex::EventManager& events);
+    SFGUISystem(sf::RenderWindow& rw, ex::EntityManager& entities, ex::EventManager& events,
+                const Config& config, ShapeLibrary& shapes);
 
 public:
     /** EntityX Interfaces **/
     //Draw the GUI and etc, and emit events if needed
     void update(ex::EntityManager&, ex::EventManager&, ex::TimeDelta dt) override;
 
+    //EntityX event listeners; statistics for the readouts
+    void configure(ex::EventManager& events) override;
+    void receive(const PhysicsStatsEvent& e);
+    void receive(const ContactBatchEvent& e);
+    void receive(const ProfileEvent& e);
+    void receive(const ConfigEvent& e);
+    void receive(const QualityEvent& e);
+
 private:
     //General GUI components
     void createTheGUI();
+    const Config& config;         //Initial widget values
     sf::RenderWindow& window;     //Window to draw to
     sfg::SFGUI gui;               //Obligatory
     sfg::Window::Ptr gui_window;  //The single GUI window
 
-    /* Slider section and data, because the sfg::Scale doesn't have slider
-     * dragged/dropped events, we poll the sliders each update() with this data */
-    void checkSliderEvents();
-    sfg::Scale::Ptr gravx, gravy, colorr, colorg, colorb;
-    sf::Vector2f storedGrav;
-    sf::Color storedColor;
+    /* Slider section. Sliders are bound to parameters that publish an event
+     * when changed, throttled to one event per GUI_PARAM_INTERVAL_MS */
+    void publishGravity();
+    void publishLightColor();
+    void publishSolverSetting(PhysicsEvent::TYPE type, sfg::Adjustment::Ptr adjustment, bool integral);
+    void publishSolverToggle(PhysicsEvent::TYPE type, std::weak_ptr<sfg::CheckButton> button);
+    void publishTimeSetting(TimeEvent::TYPE type, sfg::Adjustment::Ptr adjustment);
+    void publishPause();
+    void publishHistorySeek();
+    sfg::Scale::Ptr gravx, gravy, colorr, colorg, colorb, timeline;
+    sfg::CheckButton::Ptr pauseButton;
+    ParameterSet parameters;
+
+    //Shape files spawned by Shift + left click, chosen with the combo box
+    void loadShapeList();
+    ShapeLibrary& shapes;
+    std::vector<std::shared_ptr<const ShapeAsset>> shapeList;
+    sfg::ComboBox::Ptr shapeCombo;
+
+    //Solver and time widgets by config key, so edits to the config file show up in the GUI
+    std::vector<std::pair<cfg::Key, sfg::SpinButton::Ptr>> solverSpins;
+    std::vector<std::pair<cfg::Key, sfg::CheckButton::Ptr>> solverToggles;
+
+    /* Live Box2D cost readout. Stats arrive every frame but the label is only
+     * rewritten a few times a second, with the step time averaged over that */
+    void updateStatsReadout();
+    sfg::Label::Ptr physicsStats;
+    PhysicsStatsEvent lastStats;
+    b2Profile profileSum;
+    float stepTimeSum;
+    float simulatedSum;         //Simulated seconds, over the wall time of statsClock
+    int stepsSum;
+    int statsFrames;
+    int contactSums[3];         //By Contact::TYPE
+    std::size_t contactsDropped;
+    sf::Clock statsClock;
+
+    //Profiler tab; the governor's quality level, and allocations per frame by
+    //subsystem averaged over the same period as the physics readout
+    sfg::Widget::Ptr createProfilerPage();
+    sfg::Label::Ptr qualityLabel;
+    sfg::Label::Ptr allocLabels[alloc::TAG_COUNT][3];
+    alloc::Counters allocSums[alloc::TAG_COUNT];
+    int profileFrames;
 
     /* For the "Graphics" checkboxes, this is a map of the event type to the button
      * handle in SFGUI, and the placement in the table the buttons are packed in */
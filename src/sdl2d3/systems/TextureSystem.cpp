@@ -1,50 +1,72 @@
+#include <algorithm>
+#include "utility/strings.h"
 #include "utility/utility.h"
+#include "utility/view.h"
+#include "utility/trace.h"
 #include "Box2DSystem.h"
 #include "TextureSystem.h"
 
-TextureSystem::TextureSystem(sf::RenderWindow& rw, entityx::EntityManager& entities, KeyValue& keys)
+TextureSystem::TextureSystem(sf::RenderTarget& rw, entityx::EntityManager& entities, const Config& config, const Level& level,
+                             JobSystem& jobs)
     : window(rw)
     , imageRenderEnabled(false)
     , randomTexturesEnabled(true)
     , positionTextEnabled(false)
+    , labelsHidden(false)
+    , assetsStale(false)
     , entities(entities)
+    , config(config)
+    , level(level)
+    , jobs(jobs)
 {
-    /* This doesn't change. It maps the type shape to the vector of textures aviliable
-     * under random texturing, or we use the first for no random textures */
-    texturemap = {
-        {    SpawnComponent::BOX, {&boxTextures,  conf::box_halfwidth*2}},
-        { SpawnComponent::CIRCLE, {&ballTextures, conf::circle_radius*2}}
-    };
+    loadAssets();
+}
 
+void TextureSystem::loadAssets()
+{
+    TRACE_SCOPE("TextureSystem::loadAssets");
     /* Textures for physics objects
      * `loadTextures` reads a key from an .ini consisting of colon-delimited
-     * textures, and loads them into a vector */
-    loadTextures(boxTextures,  keys.GetString("BOX_TEXTURES"));
-    loadTextures(ballTextures, keys.GetString("BALL_TEXTURES"));
+     * textures, and loads them into the shape's bank */
+    forEachShape([&](auto traits) {
+        typedef decltype(traits) Shape;
+        textureBanks[Shape::textureBank].clear();
+        loadTextures(textureBanks[Shape::textureBank], config.getString(Shape::textures));
+    });
 
     //Load background texture and make it repeating
-    bgTexture.loadFromFile(keys.GetString("BACKGROUND_TEXTURE"));
+    bgTexture.loadFromFile(config.getString(cfg::BACKGROUND_TEXTURE));
     bgTexture.setRepeated(true);
     bgSprite.setTexture(bgTexture);
-    auto windsz = rw.getSize();
+    auto windsz = window.getSize();
     bgSprite.setTextureRect(sf::IntRect(0, 0, windsz.x, windsz.y));
 
     //Font for displaying positions and other things
-    boxFont.loadFromFile(keys.GetString("OBJECT_FONT"));
+    boxFont.loadFromFile(config.getString(cfg::OBJECT_FONT));
+    positionLabels.setFont(boxFont, 12);
+
+    //Level texture, tiled across the level's blocks
+    levelTexture.loadFromFile(config.getString(cfg::LEVEL_TEXTURE));
+    levelTexture.setRepeated(true);
+    buildLevelVertices();
+    staticLayer.invalidate();
 }
 
-//General-porpose string split function
-static std::vector<std::string> strSplit(const std::string& target, const std::string& delim)
+void TextureSystem::buildLevelVertices()
 {
-    std::vector<std::string> result;
-    size_t startPos = 0, it = 0;
-    do {
-        it = target.find(delim, startPos);
-        result.push_back(target.substr(startPos, it - startPos));
-        startPos = it + delim.length();
+    //Texture coordinates are world pixels, so the repeated texture lines up across blocks
+    levelVertices.clear();
+    levelVertices.setPrimitiveType(sf::Quads);
+    for(const sf::FloatRect& block : level.blocks()) {
+        sf::Vector2f corners[4] = {
+            {block.left, block.top},
+            {block.left + block.width, block.top},
+            {block.left + block.width, block.top + block.height},
+            {block.left, block.top + block.height}
+        };
+        for(const sf::Vector2f& corner : corners)
+            levelVertices.append(sf::Vertex(corner, corner));
     }
-    while(it != std::string::npos);
-    return result;
 }
 
 void TextureSystem::loadTextures(std::vector<sf::Texture>& dest, const std::string& colonpaths)
@@ -59,41 +81,68 @@ void TextureSystem::loadTextures(std::vector<sf::Texture>& dest, const std::stri
 
 void TextureSystem::update(ex::EntityManager&, ex::EventManager&, ex::TimeDelta)
 {
+    TRACE_SCOPE("TextureSystem::update");
+    //Handle GUI events posted since the last frame; retexturing happens here
+    graphicsEvents.drain([this](const GraphicsEvent& e) { handle(e); });
+    if(assetsStale) {
+        assetsStale = false;
+        loadAssets();
+        for(ex::Entity e : entities.entities_with_components<TextureComponent>())
+            retexture(e);
+    }
+
     //Untextured entities, deal with them
     for(ex::Entity e : unspawned)
         addToWorld(e);
     unspawned.clear();
 
-    //Draw background first if enabled
-    if(imageRenderEnabled)
-        window.draw(bgSprite);
+    //Draw background first if enabled, then the level over it. Both come from the cache
+    if(imageRenderEnabled) {
+        staticLayer.draw(window, [this](sf::RenderTarget& target) {
+            target.draw(bgSprite);
+            target.draw(levelVertices, &levelTexture);
+        });
+    }
 
     /* For each entity, the texture and position text info are updated from the
-     * Box2D component, if enabled */
-    auto box = ex::ComponentHandle<Box2DComponent>();
-    auto tex = ex::ComponentHandle<TextureComponent>();
-    for(ex::Entity e : entities.entities_with_components(box, tex))
-    {
-        (void)e;
-        b2Body* body = box->body;
+     * Box2D component, if enabled. Entities outside the view are skipped before
+     * anything is transformed or submitted. Transforms and label quads are worked
+     * out on the job threads; only the draw calls are made from this one */
+    bool showLabels = positionTextEnabled && !labelsHidden;
+    if(showLabels)
+        positionLabels.reserve(entities.capacity());
+    else
+        positionLabels.release();
+    if(!imageRenderEnabled && !showLabels)
+        return;
+    sf::FloatRect visible = viewBounds(window.getView());
+    textured.parallel_each(jobs, 256, [&](ex::Entity e, Box2DComponent& box, TextureComponent& tex) {
+        b2Body* body = box.body;
         b2Vec2  position = body->GetPosition();
         sf::Vector2f adjusted = {pixels(position.x), pixels(position.y)};
+        tex.visible = inBounds(visible, adjusted, tex.radius);
+        if(!tex.visible)
+            return;
 
         if(imageRenderEnabled) {
-            sf::Sprite& sprite = tex->sprite;
-            sprite.setPosition(adjusted);
-            sprite.setRotation(body->GetAngle() * (180 / M_PI));
-            window.draw(sprite);
-        }
-        if(positionTextEnabled) {
-            char buffer[32];
-            std::snprintf(buffer, 32, "[%.3d,%.3d]", (int)adjusted.x, (int)adjusted.y);
-            sf::Text& text = tex->positionText;
-            text.setString(buffer);
-            text.setPosition(adjusted.x-28, adjusted.y-8);
-            window.draw(text);
+            tex.sprite.setPosition(adjusted);
+            tex.sprite.setRotation(body->GetAngle() * (180 / M_PI));
         }
-    }
+        //Only rebuilt when the whole-pixel position changes
+        if(showLabels)
+            positionLabels.update(e.id().index(), {(int)adjusted.x, (int)adjusted.y});
+    });
+
+    positionLabels.clear();
+    textured.each([&](ex::Entity e, Box2DComponent&, TextureComponent& tex) {
+        if(!tex.visible)
+            return;
+        if(imageRenderEnabled)
+            window.draw(tex.sprite);
+        if(showLabels)
+            positionLabels.add(e.id().index());
+    });
+    positionLabels.draw(window);
 }
 
 void TextureSystem::addToWorld(entityx::Entity e)
@@ -103,44 +152,55 @@ void TextureSystem::addToWorld(entityx::Entity e)
 
 void TextureSystem::retexture(entityx::Entity e)
 {
+    TRACE_SCOPE("TextureSystem::retexture");
     //Add a texture component if it is not there. Lazy initialization
     if(!e.has_component<TextureComponent>()) {
         e.assign<TextureComponent>(sf::Sprite());
     }
 
-    /* Use the texturemap on the type the ent was spawned with to choose a random texure.
-     * Then, the new texture needs to be scaled to the Box2D component */
+    /* Use the bank of the shape the ent was spawned with to choose a random texure
+     * (or the first, for no random textures). Then, the new texture needs to be
+     * scaled to the Box2D component */
     auto textureComponent = e.component<TextureComponent>();
-    auto spawnShape = e.component<SpawnComponent>()->type;
-    auto& textureBank = texturemap.at(spawnShape).first;
     sf::Sprite& s = textureComponent->sprite;
-    s.setTexture(textureBank->at(rand() % (randomTexturesEnabled ? textureBank->size() : 1)), true);
-    scaleTexture(e);
-
-    //Set font info
-    sf::Text& text = textureComponent->positionText;
-    text.setFont(boxFont);
-    text.setCharacterSize(12);
+    auto spawn = e.component<SpawnComponent>();
+    withShape(spawn->type, [&](auto traits) {
+        typedef decltype(traits) Shape;
+        const auto& textureBank = textureBanks[Shape::textureBank];
+        s.setTexture(textureBank.at(rand() % (randomTexturesEnabled ? textureBank.size() : 1)), true);
+        scaleTexture(s, pixels(Shape::extent(*spawn) * 2));
+        //The square sprite's corner (sqrt 2 of its halfwidth), or the position label, whichever reaches further
+        textureComponent->radius = std::max(pixels(Shape::extent(*spawn)) * 1.42f, 32.f);
+    });
 }
 
-void TextureSystem::scaleTexture(entityx::Entity e)
+void TextureSystem::scaleTexture(sf::Sprite& s, float size)
 {
-    sf::Sprite& s = e.component<TextureComponent>()->sprite;
-    auto type = e.component<SpawnComponent>()->type;
-    float scalar = pixels(texturemap[type].second);
     auto texsize = s.getTexture()->getSize();
     s.setOrigin(texsize.x/2, texsize.y/2);
-    s.setScale(1,1);
-    s.scale(scalar / texsize.x, scalar / texsize.y);
+    s.setScale(size / texsize.x, size / texsize.y);
 }
 
 void TextureSystem::configure(entityx::EventManager& events)
 {
     events.subscribe<GraphicsEvent>(*this);
     events.subscribe<ex::ComponentAddedEvent<SpawnComponent>>(*this);
+    events.subscribe<ConfigEvent>(*this);
+    events.subscribe<QualityEvent>(*this);
+    textured.configure(entities, events);
+}
+
+void TextureSystem::receive(const QualityEvent& e)
+{
+    labelsHidden = e.level >= QualityEvent::NoLabels;
 }
 
 void TextureSystem::receive(const GraphicsEvent& e)
+{
+    graphicsEvents.push(e);
+}
+
+void TextureSystem::handle(const GraphicsEvent& e)
 {
     switch(e.type) {
     case GraphicsEvent::ImageRender: {
@@ -167,3 +227,11 @@ void TextureSystem::receive(const ex::ComponentAddedEvent<SpawnComponent>& e)
 {
     unspawned.push_back(e.entity);
 }
+
+void TextureSystem::receive(const ConfigEvent& e)
+{
+    //Reload everything in the next update if any texture or font path was edited
+    if(e.changed.test(cfg::BOX_TEXTURES) || e.changed.test(cfg::BALL_TEXTURES) || e.changed.test(cfg::SHAPE_TEXTURES) ||
+       e.changed.test(cfg::BACKGROUND_TEXTURE) || e.changed.test(cfg::OBJECT_FONT) || e.changed.test(cfg::LEVEL_TEXTURE))
+        assetsStale = true;
+}
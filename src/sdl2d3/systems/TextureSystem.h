@@ -1,11 +1,16 @@
 #ifndef TEXTURESYSTEM_H
 #define TEXTURESYSTEM_H
 
-#include <map>
 #include <entityx/entityx.h>
-#include "utility/keyvalues.h"
+#include "utility/config.h"
+#include "utility/EventQueue.h"
+#include "utility/LabelBatch.h"
+#include "utility/StaticLayer.h"
 #include "sdl2d3/events.h"
 #include "sdl2d3/components.h"
+#include "sdl2d3/componentview.h"
+#include "sdl2d3/level.h"
+#include "sdl2d3/shapes.h"
 namespace ex = entityx;
 
 /* The texture system takes the world entities (with Box2DLTBLComponent)
@@ -15,7 +20,8 @@ namespace ex = entityx;
 class TextureSystem : public ex::System<TextureSystem>, public ex::Receiver<TextureSystem>
 {
 public:
-    TextureSystem(sf::RenderWindow& rw,  ex::EntityManager& entities, KeyValue& keys);
+    TextureSystem(sf::RenderTarget& rw,  ex::EntityManager& entities, const Config& config, const Level& level,
+                  JobSystem& jobs);
 
 public:
     /** EntityX Interfaces **/
@@ -26,35 +32,56 @@ public:
     void configure(ex::EventManager& events) override;
     void receive(const GraphicsEvent& e);
     void receive(const ex::ComponentAddedEvent<SpawnComponent>& e);
+    void receive(const ConfigEvent& e);
+    void receive(const QualityEvent& e);
 
 private:
-    //Reference to window to draw below textures to
-    sf::RenderWindow& window;
+    //Reference to window (or offscreen texture) to draw below textures to
+    sf::RenderTarget& window;
 
-    //Textures; Multiple are supported for boxes/balls.
+    //Textures; Multiple are supported for boxes/balls/shapes.
     //`loadTextures` loads a colon-delimited list of textures into a vector
-    //`texturemap` is a map of "type" -> {aviliable textures for type, Box2D scale factor}
-    std::map<SpawnComponent::TYPE, std::pair<std::vector<sf::Texture>*,float>> texturemap;
+    //`textureBanks` holds the aviliable textures for each ShapeTraits::textureBank
+    void loadAssets();
     void loadTextures(std::vector<sf::Texture>&, const std::string&);
-    std::vector<sf::Texture> boxTextures, ballTextures;
+    std::vector<sf::Texture> textureBanks[shapeTextureBanks];
     sf::Texture bgTexture;
     sf::Sprite bgSprite;
     sf::Font boxFont;
+    LabelBatch positionLabels;  //All position labels by entity index, drawn in one call
+
+    //The level's blocks as one textured vertex array, built with the assets
+    void buildLevelVertices();
+    sf::Texture levelTexture;
+    sf::VertexArray levelVertices;
+
+    //Background and level, re-rendered only when the view changes
+    StaticLayer staticLayer;
 
     //Figure out textures for an entity, and handle untextures entities
     void addToWorld(ex::Entity e);
     void retexture(ex::Entity e);
-    void scaleTexture(ex::Entity e);
+    void scaleTexture(sf::Sprite& s, float size);
     std::list<ex::Entity> unspawned;
+    ComponentView<Box2DComponent, TextureComponent> textured;   //Drawn each frame
+
+    //GUI events are queued by receive() and handled at the start of update()
+    void handle(const GraphicsEvent& e);
+    EventQueue<GraphicsEvent> graphicsEvents;
 
     //State data. Passed from Graphics portion of GUI window
     bool imageRenderEnabled;
     bool randomTexturesEnabled;
     bool positionTextEnabled;
+    bool labelsHidden;      //By the quality governor, whatever the GUI says
+    bool assetsStale;       //Texture or font paths edited; reloaded, and sprites retextured, in update()
 
 private:
-    //EntityX reference data, convience.
+    //EntityX reference data, convience. Config to reload textures from
     ex::EntityManager& entities;
+    const Config& config;
+    const Level& level;
+    JobSystem& jobs;        //Sprite transforms and labels are updated in parallel
 };
 
 #endif // TEXTURESYSTEM_H
@@ -0,0 +1,130 @@
+/* Parameter sweeps without a window. Every combination of the listed config
+ * values is run once per seed as a headless Simulation, all of them spread over
+ * the job system's threads, and one CSV row per run is written to stdout.
+ *
+ * Usage: sweep [-c config] [-f frames] [-n seeds] [-j threads] [KEY=value,value...]...
+ * e.g.   sweep -n 4 -f 1200 BOX2D_SUBSTEPS=1,2,4 BOX2D_RESTITUTION=0,0.3 > sweep.csv */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "utility/config.h"
+#include "utility/JobSystem.h"
+#include "utility/strings.h"
+#include "utility/trace.h"
+#include "sdl2d3/level.h"
+#include "sdl2d3/simulation.h"
+
+namespace {
+
+struct Axis
+{
+    cfg::Key key;
+    std::vector<std::string> values;
+};
+
+int usage(const char* program)
+{
+    std::fprintf(stderr, "Usage: %s [-c config] [-f frames] [-n seeds] [-j threads] [KEY=value,value...]...\n",
+                 program);
+    return EXIT_FAILURE;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::string path = "config.ini";
+    int frames = 600, seeds = 1, threads = 0;
+    std::vector<Axis> axes;
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "-c" && hasValue) {
+            path = argv[++i];
+        } else if(arg == "-f" && hasValue) {
+            frames = std::atoi(argv[++i]);
+        } else if(arg == "-n" && hasValue) {
+            seeds = std::atoi(argv[++i]);
+        } else if(arg == "-j" && hasValue) {
+            threads = std::atoi(argv[++i]);
+        } else if(arg.find('=') != std::string::npos) {
+            Axis axis;
+            std::string name = arg.substr(0, arg.find('='));
+            if(!Config::find(name, axis.key)) {
+                std::cerr << "Sweep: Unknown key " << name << std::endl;
+                return EXIT_FAILURE;
+            }
+            axis.values = strSplit(arg.substr(name.size() + 1), ",");
+            if(axis.values.empty())
+                return usage(argv[0]);
+            axes.push_back(axis);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if(frames <= 0 || seeds <= 0 || threads < 0)
+        return usage(argv[0]);
+
+    Config base;
+    base.load(path);
+    trace::setEnabled(false);
+    Level level;
+    level.load(base.getString(cfg::LEVEL_FILE), base.getFloat(cfg::LEVEL_TILE_SIZE));
+
+    /* Runs are built here, one after another, and only stepped in parallel. Each
+     * combination picks its values like the digits of a number, the last axis
+     * fastest, and is run once per seed, so run r has seed r % seeds + 1 */
+    std::size_t combinations = 1;
+    for(const Axis& axis : axes)
+        combinations *= axis.values.size();
+    std::vector<std::unique_ptr<Simulation>> runs;
+    for(std::size_t c = 0; c != combinations; ++c) {
+        Config config = base;
+        std::size_t rest = c;
+        for(auto axis = axes.rbegin(); axis != axes.rend(); ++axis) {
+            const std::string& value = axis->values[rest % axis->values.size()];
+            rest /= axis->values.size();
+            if(!config.set(axis->key, value)) {
+                std::cerr << "Sweep: Invalid value " << value << " for " << Config::name(axis->key) << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        for(int seed = 1; seed <= seeds; ++seed)
+            runs.push_back(std::make_unique<Simulation>(config, level, seed));
+    }
+
+    //Bodies are only spawned by run(), and each world is freed as soon as its run is
+    //done, so only the runs in progress hold a full world at any time
+    std::vector<Simulation::Result> results(runs.size());
+    JobSystem jobs(JobSystem::workersFor(threads));
+    jobs.parallel_for(runs.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for(std::size_t r = begin; r != end; ++r) {
+            results[r] = runs[r]->run(frames);
+            runs[r].reset();
+        }
+    });
+
+    std::printf("run,seed");
+    for(const Axis& axis : axes)
+        std::printf(",%s", Config::name(axis.key));
+    std::printf(",bodies,awake,settle_s,kinetic_j,impacts,step_ms,max_step_ms,wall_ms\n");
+    for(std::size_t r = 0; r != results.size(); ++r) {
+        const Simulation::Result& result = results[r];
+        std::printf("%zu,%zu", r, r % seeds + 1);
+        std::size_t rest = r / seeds;
+        std::vector<const std::string*> values(axes.size());
+        for(std::size_t a = axes.size(); a-- != 0;) {
+            values[a] = &axes[a].values[rest % axes[a].values.size()];
+            rest /= axes[a].values.size();
+        }
+        for(const std::string* value : values)
+            std::printf(",%s", value->c_str());
+        std::printf(",%d,%d,%.3f,%.4f,%ld,%.3f,%.3f,%.1f\n", result.bodies, result.awake, result.settleTime,
+                    result.kineticEnergy, result.impacts, result.meanStep, result.maxStep, result.wallTime);
+    }
+    return EXIT_SUCCESS;
+}
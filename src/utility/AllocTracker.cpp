@@ -0,0 +1,119 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "AllocTracker.h"
+
+namespace {
+
+thread_local alloc::Tag current = alloc::Other;
+
+#ifdef SDL2D3_TRACK_ALLOCATIONS
+
+struct Slot
+{
+    std::atomic<std::uint64_t> allocations;
+    std::atomic<std::uint64_t> bytes;
+    std::atomic<std::int64_t> live;
+};
+Slot slots[alloc::TAG_COUNT];   //Zero before any constructor runs, as a static
+
+//Each block is prefixed with its size and tag, so delete can credit the tag that allocated it
+struct alignas(std::max_align_t) Header
+{
+    std::size_t size;
+    alloc::Tag tag;
+};
+
+void* allocate(std::size_t size)
+{
+    Header* header = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+    if(header == nullptr)
+        return nullptr;
+    header->size = size;
+    header->tag = current;
+    Slot& slot = slots[current];
+    slot.allocations.fetch_add(1, std::memory_order_relaxed);
+    slot.bytes.fetch_add(size, std::memory_order_relaxed);
+    slot.live.fetch_add(size, std::memory_order_relaxed);
+    return header + 1;
+}
+
+void release(void* ptr)
+{
+    if(ptr == nullptr)
+        return;
+    Header* header = static_cast<Header*>(ptr) - 1;
+    slots[header->tag].live.fetch_sub(header->size, std::memory_order_relaxed);
+    std::free(header);
+}
+
+#endif
+
+}
+
+namespace alloc {
+
+Counters read(Tag tag)
+{
+#ifdef SDL2D3_TRACK_ALLOCATIONS
+    const Slot& slot = slots[tag];
+    return {slot.allocations.load(std::memory_order_relaxed), slot.bytes.load(std::memory_order_relaxed),
+            slot.live.load(std::memory_order_relaxed)};
+#else
+    (void)tag;
+    return {0, 0, 0};
+#endif
+}
+
+const char* name(Tag tag)
+{
+    static const char* names[TAG_COUNT] = {"Other", "Physics", "Texture", "Light", "GUI", "Particles"};
+    return names[tag];
+}
+
+Scope::Scope(Tag tag)
+    : previous(current)
+{
+    current = tag;
+}
+
+Scope::~Scope()
+{
+    current = previous;
+}
+
+}
+
+#ifdef SDL2D3_TRACK_ALLOCATIONS
+
+void* operator new(std::size_t size)
+{
+    void* ptr = allocate(size);
+    if(ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept                         { release(ptr); }
+void operator delete[](void* ptr) noexcept                       { release(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept            { release(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept          { release(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept  { release(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept{ release(ptr); }
+
+#endif
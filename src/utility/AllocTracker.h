@@ -0,0 +1,47 @@
+#ifndef ALLOCTRACKER_H
+#define ALLOCTRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* Opt-in heap instrumentation. When built with SDL2D3_TRACK_ALLOCATIONS, the
+ * global operator new and delete count every allocation against the subsystem
+ * tag active on the calling thread, which alloc::Scope sets. Without it the hooks
+ * are not compiled in and every counter reads zero. */
+
+namespace alloc {
+
+enum Tag { Other, Physics, Texture, Light, Gui, Particles, TAG_COUNT };
+
+#ifdef SDL2D3_TRACK_ALLOCATIONS
+constexpr bool tracking = true;
+#else
+constexpr bool tracking = false;
+#endif
+
+//Totals for one tag since startup; subtract two reads for a per-frame figure
+struct Counters
+{
+    std::uint64_t allocations;
+    std::uint64_t bytes;
+    std::int64_t  live;     //Bytes allocated under the tag and not yet freed
+};
+
+Counters read(Tag tag);
+const char* name(Tag tag);
+
+//Attributes allocations made on this thread to `tag` while in scope
+class Scope
+{
+public:
+    explicit Scope(Tag tag);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+private:
+    Tag previous;
+};
+
+}
+
+#endif // ALLOCTRACKER_H
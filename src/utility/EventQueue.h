@@ -0,0 +1,79 @@
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include <atomic>
+#include <vector>
+
+/* A lock-free multi-producer, single-consumer queue used to defer events.
+ * Any thread may push(); the owning system calls drain() at a fixed point in
+ * its update. It is double-buffered: drain() atomically takes everything posted
+ * so far, so events pushed by handlers during a drain land in the next frame. */
+
+template<typename T>
+class EventQueue
+{
+public:
+    EventQueue() : pending(nullptr) { }
+    EventQueue(const EventQueue&) = delete;
+    EventQueue& operator=(const EventQueue&) = delete;
+
+    ~EventQueue()
+    {
+        freeList(pending.exchange(nullptr));
+    }
+
+    //Post an event. Safe to call from any thread
+    void push(const T& value)
+    {
+        Node* node = new Node{value, pending.load(std::memory_order_relaxed)};
+        while(!pending.compare_exchange_weak(node->next, node,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed))
+            ;
+    }
+
+    //Hand every event posted before this call to `handler`, in posting order.
+    //Only the owning (consumer) thread may drain
+    template<typename F>
+    void drain(F&& handler)
+    {
+        Node* head = pending.exchange(nullptr, std::memory_order_acquire);
+        if(head == nullptr)
+            return;
+
+        //The pending list is LIFO; copy it out back-to-front into the front buffer
+        front.clear();
+        for(Node* n = head; n != nullptr; n = n->next)
+            front.push_back(n->value);
+        freeList(head);
+
+        for(auto it = front.rbegin(); it != front.rend(); ++it)
+            handler(*it);
+    }
+
+    bool empty() const
+    {
+        return pending.load(std::memory_order_relaxed) == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        T value;
+        Node* next;
+    };
+
+    static void freeList(Node* n)
+    {
+        while(n != nullptr) {
+            Node* next = n->next;
+            delete n;
+            n = next;
+        }
+    }
+
+    std::atomic<Node*> pending;   //Back buffer; producers push here
+    std::vector<T> front;         //Front buffer; the batch being handled
+};
+
+#endif // EVENTQUEUE_H
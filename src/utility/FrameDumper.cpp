@@ -0,0 +1,48 @@
+#include <iostream>
+#include "FrameDumper.h"
+#include "trace.h"
+
+FrameDumper::FrameDumper(std::size_t maxPending)
+    : maxPending(maxPending)
+    , stopping(false)
+    , writer(&FrameDumper::run, this)
+{
+}
+
+FrameDumper::~FrameDumper()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    writer.join();
+}
+
+void FrameDumper::push(sf::Image image, const std::string& path)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    space.wait(lock, [this] { return pending.size() < maxPending; });
+    pending.push_back(Frame{std::move(image), path});
+    lock.unlock();
+    ready.notify_one();
+}
+
+void FrameDumper::run()
+{
+    trace::setThreadName("FrameDumper");
+    for(;;) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return stopping || !pending.empty(); });
+        if(pending.empty())
+            return;
+        Frame frame = std::move(pending.front());
+        pending.pop_front();
+        lock.unlock();
+        space.notify_one();
+
+        TRACE_SCOPE("FrameDumper::save");
+        if(!frame.image.saveToFile(frame.path))
+            std::cerr << "FrameDumper: Couldn't write " << frame.path << std::endl;
+    }
+}
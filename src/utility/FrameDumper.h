@@ -0,0 +1,44 @@
+#ifndef FRAMEDUMPER_H
+#define FRAMEDUMPER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <SFML/Graphics/Image.hpp>
+
+/* Writes captured frames to image files on a background thread, so PNG
+ * encoding and disk writes stay out of the frame loop. At most `maxPending`
+ * frames are held; push() waits for the writer beyond that rather than
+ * letting memory grow. Frames still queued are written before destruction. */
+
+class FrameDumper
+{
+public:
+    explicit FrameDumper(std::size_t maxPending = 8);
+    ~FrameDumper();
+    FrameDumper(const FrameDumper&) = delete;
+    FrameDumper& operator=(const FrameDumper&) = delete;
+
+    //Queue an image to be saved to `path`; the format follows the extension
+    void push(sf::Image image, const std::string& path);
+
+private:
+    void run();
+
+    struct Frame
+    {
+        sf::Image image;
+        std::string path;
+    };
+    std::deque<Frame> pending;
+    std::size_t maxPending;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable ready;  //Signalled when a frame is queued, or on stop
+    std::condition_variable space;  //Signalled when a frame has been taken
+    std::thread writer;
+};
+
+#endif // FRAMEDUMPER_H
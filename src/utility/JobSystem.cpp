@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cstdio>
+#include "JobSystem.h"
+#include "trace.h"
+
+JobSystem::JobSystem(unsigned workers)
+    : queued(0)
+    , unfinished(0)
+    , stopping(false)
+{
+    for(unsigned i = 0; i != workers + 1; ++i)
+        queues.emplace_back(new Queue);
+    for(unsigned i = 0; i != workers; ++i)
+        threads.emplace_back(&JobSystem::work, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(std::thread& thread : threads)
+        thread.join();
+}
+
+unsigned JobSystem::workersFor(int setting)
+{
+    if(setting > 0)
+        return setting - 1;
+    unsigned hardware = std::thread::hardware_concurrency();
+    return (hardware > 1) ? hardware - 1 : 0;
+}
+
+void JobSystem::parallel_for(std::size_t count, std::size_t grain, const Range& body)
+{
+    grain = std::max<std::size_t>(grain, 1);
+    if(threads.empty() || count <= grain) {
+        if(count != 0)
+            body(0, count);
+        return;
+    }
+
+    //Deal the chunks out round robin, then wake the workers to take them. They are
+    //counted first so `queued` never drops below zero when a worker is quick
+    std::size_t chunks = (count + grain - 1) / grain;
+    unfinished = chunks;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        queued += chunks;
+    }
+    for(std::size_t i = 0; i != chunks; ++i) {
+        Queue& queue = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(Job{&body, i * grain, std::min(count, (i + 1) * grain)});
+    }
+    wake.notify_all();
+
+    //Help out, then wait for the chunks other threads are still running
+    Job job;
+    unsigned self = queues.size() - 1;
+    while(unfinished.load(std::memory_order_acquire) != 0) {
+        if(take(self, job))
+            run(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::work(unsigned index)
+{
+    char name[32];
+    std::snprintf(name, sizeof name, "Job %u", index);
+    trace::setThreadName(name);
+
+    Job job;
+    for(;;) {
+        if(take(index, job)) {
+            run(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait(lock, [this] { return stopping || queued != 0; });
+        if(stopping)
+            return;
+    }
+}
+
+bool JobSystem::take(unsigned index, Job& job)
+{
+    //Our own queue from the front, then the others from the back
+    for(std::size_t i = 0; i != queues.size(); ++i) {
+        Queue& queue = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(queue.jobs.empty())
+            continue;
+        if(i == 0) {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+        } else {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+        }
+        --queued;
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::run(const Job& job)
+{
+    TRACE_SCOPE("JobSystem::chunk");
+    (*job.body)(job.begin, job.end);
+    unfinished.fetch_sub(1, std::memory_order_release);
+}
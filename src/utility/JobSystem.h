@@ -0,0 +1,67 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A fixed pool of worker threads for data-parallel loops. parallel_for() cuts
+ * a range into chunks and deals them out to per-thread queues; a thread that
+ * runs out takes chunks from the back of another's queue, so uneven chunks
+ * still keep every thread busy. The calling thread works on the loop too and
+ * returns once every chunk has run.
+ *
+ * Only one thread may call parallel_for() at a time, and bodies must not call
+ * it themselves. With no workers, loops simply run on the calling thread. */
+
+class JobSystem
+{
+public:
+    typedef std::function<void(std::size_t begin, std::size_t end)> Range;
+
+    //`workers` extra threads; 0 runs everything on the caller
+    explicit JobSystem(unsigned workers);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    //Worker count for a JOB_THREADS setting; 0 means one less than the hardware threads
+    static unsigned workersFor(int setting);
+
+    //Threads taking part in a loop, the caller included
+    unsigned size() const { return queues.size(); }
+
+    //Run body(begin, end) over [0, count) in chunks of at most `grain` items
+    void parallel_for(std::size_t count, std::size_t grain, const Range& body);
+
+private:
+    struct Job
+    {
+        const Range* body;
+        std::size_t begin, end;
+    };
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void work(unsigned index);
+    bool take(unsigned index, Job& job);    //From our own queue, or stolen from another
+    void run(const Job& job);
+
+    std::vector<std::unique_ptr<Queue>> queues;     //One per thread; the caller's is last
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> queued;        //Chunks in the queues, for sleeping workers
+    std::atomic<std::size_t> unfinished;    //Chunks of the current loop not done yet
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping;
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstdio>
+#include "LabelBatch.h"
+
+namespace {
+
+//Every character a label can contain
+const char labelChars[] = "0123456789-[],";
+
+//Offset from the labelled point to the label's top left, in pixels
+const sf::Vector2f labelOffset(-28, -8);
+
+}
+
+void LabelBatch::setFont(const sf::Font& f, unsigned characterSize)
+{
+    //Requesting each glyph once puts it in the font's atlas, so the texture stays put afterwards
+    font = &f;
+    size = characterSize;
+    release();
+    for(Glyph& glyph : glyphs)
+        glyph = Glyph{{0, 0, 0, 0}, {0, 0, 0, 0}, 0};
+    for(const char* c = labelChars; *c; ++c) {
+        const sf::Glyph& g = font->getGlyph(*c, size, false);
+        glyphs[(int)*c] = Glyph{g.bounds, sf::FloatRect(g.textureRect), g.advance};
+    }
+}
+
+void LabelBatch::reserve(std::size_t slots)
+{
+    if(labels.size() < slots)
+        labels.resize(slots);
+}
+
+void LabelBatch::release()
+{
+    std::vector<Label>().swap(labels);
+}
+
+void LabelBatch::update(std::size_t slot, const sf::Vector2i& value)
+{
+    Label& label = labels[slot];
+    if(label.value == value)
+        return;
+    label.value = value;
+
+    char buffer[maxChars + 1];
+    int length = std::snprintf(buffer, sizeof buffer, "[%.3d,%.3d]", value.x, value.y);
+    length = std::min(length, (int)maxChars);
+
+    //Same layout sf::Text uses: the baseline sits one character size below the top
+    sf::Vector2f pen = sf::Vector2f(value) + labelOffset + sf::Vector2f(0, size);
+    label.count = 0;
+    for(int i = 0; i != length; ++i) {
+        const Glyph& glyph = glyphs[(int)buffer[i]];
+        float left   = pen.x + glyph.bounds.left;
+        float top    = pen.y + glyph.bounds.top;
+        float right  = left + glyph.bounds.width;
+        float bottom = top + glyph.bounds.height;
+        float u1 = glyph.texture.left, v1 = glyph.texture.top;
+        float u2 = u1 + glyph.texture.width, v2 = v1 + glyph.texture.height;
+
+        sf::Vertex* quad = &label.vertices[label.count];
+        quad[0] = sf::Vertex(sf::Vector2f(left, top),     sf::Vector2f(u1, v1));
+        quad[1] = sf::Vertex(sf::Vector2f(right, top),    sf::Vector2f(u2, v1));
+        quad[2] = sf::Vertex(sf::Vector2f(right, bottom), sf::Vector2f(u2, v2));
+        quad[3] = sf::Vertex(sf::Vector2f(left, bottom),  sf::Vector2f(u1, v2));
+        label.count += 4;
+        pen.x += glyph.advance;
+    }
+}
+
+void LabelBatch::add(std::size_t slot)
+{
+    const Label& label = labels[slot];
+    for(std::size_t i = 0; i != label.count; ++i)
+        vertices.append(label.vertices[i]);
+}
+
+void LabelBatch::draw(sf::RenderTarget& target) const
+{
+    if(font != nullptr && vertices.getVertexCount() != 0)
+        target.draw(vertices, &font->getTexture(size));
+}
@@ -0,0 +1,65 @@
+#ifndef LABELBATCH_H
+#define LABELBATCH_H
+
+#include <climits>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+/* Draws many short numeric labels ("[x,y]") in one draw call. The glyphs a
+ * label can use are rasterized into the font's atlas once by setFont(); each
+ * label keeps its own quads and only rebuilds them when its value changes, and
+ * every frame the visible labels are copied into one vertex array.
+ *
+ * Labels are kept here by slot (an entity index, say) rather than in whatever
+ * they label, and only while labels are shown, so nothing is paid for them
+ * when they are off. A label's quads only depend on its value, so a slot
+ * reused for something else just rebuilds when the value differs. */
+
+class LabelBatch
+{
+public:
+    //"[%.3d,%.3d]"; longer values are cut short
+    static constexpr std::size_t maxChars = 11;
+
+    //Prebuild the glyphs for `size` pixel text. Forgets every label
+    void setFont(const sf::Font& font, unsigned size);
+
+    //Make room for slots below `slots`, before updating them from several threads
+    void reserve(std::size_t slots);
+
+    //Free every label, while none are shown
+    void release();
+
+    //Rebuild the label in `slot` if `value` differs from what it shows, centered near
+    //`value`. Different slots may be updated at once
+    void update(std::size_t slot, const sf::Vector2i& value);
+
+    //Per frame: clear, add each visible label, then draw them all at once
+    void clear() { vertices.clear(); }
+    void add(std::size_t slot);
+    void draw(sf::RenderTarget& target) const;
+
+private:
+    //A label's cached geometry, in world pixels
+    struct Label
+    {
+        sf::Vector2i value {INT_MIN, INT_MIN};  //Position it was last built for
+        std::size_t count = 0;                  //Vertices used
+        sf::Vertex vertices[maxChars * 4];
+    };
+    std::vector<Label> labels;
+
+    //Glyph quads relative to the pen position, for the characters labels use
+    struct Glyph
+    {
+        sf::FloatRect bounds;
+        sf::FloatRect texture;
+        float advance;
+    };
+    Glyph glyphs[128];
+    const sf::Font* font = nullptr;
+    unsigned size = 0;
+    sf::VertexArray vertices {sf::Quads};
+};
+
+#endif // LABELBATCH_H
@@ -23,8 +23,8 @@ void SFMLDebugDraw::DrawPoint(const b2Vec2&, float32, const b2Color&)
 
 void SFMLDebugDraw::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) 
 {
-	sf::ConvexShape polygon(vertexCount);
-	sf::Vector2f center;
+	sf::ConvexShape& polygon = m_polygon;
+	polygon.setPointCount(vertexCount);
 	for(int i = 0; i < vertexCount; i++)
 	{
 		//polygon.setPoint(i, SFMLDraw::B2VecToSFVec(vertices[i]));
@@ -39,7 +39,8 @@ void SFMLDebugDraw::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const
 }
 void SFMLDebugDraw::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) 
 {
-	sf::ConvexShape polygon(vertexCount);
+	sf::ConvexShape& polygon = m_polygon;
+	polygon.setPointCount(vertexCount);
 	for(int i = 0; i < vertexCount; i++)
 	{
 		//polygon.setPoint(i, SFMLDraw::B2VecToSFVec(vertices[i]));
@@ -54,7 +55,8 @@ void SFMLDebugDraw::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount,
 }
 void SFMLDebugDraw::DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color) 
 {
-	sf::CircleShape circle(radius * sfdd::SCALE);
+	sf::CircleShape& circle = m_circle;
+	circle.setRadius(radius * sfdd::SCALE);
 	circle.setOrigin(radius * sfdd::SCALE, radius * sfdd::SCALE);
 	circle.setPosition(SFMLDebugDraw::B2VecToSFVec(center));
 	circle.setFillColor(sf::Color::Transparent);
@@ -65,7 +67,8 @@ void SFMLDebugDraw::DrawCircle(const b2Vec2& center, float32 radius, const b2Col
 }
 void SFMLDebugDraw::DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color) 
 {
-	sf::CircleShape circle(radius * sfdd::SCALE);
+	sf::CircleShape& circle = m_circle;
+	circle.setRadius(radius * sfdd::SCALE);
 	circle.setOrigin(radius * sfdd::SCALE, radius * sfdd::SCALE);
 	circle.setPosition(SFMLDebugDraw::B2VecToSFVec(center));
 	circle.setFillColor(SFMLDebugDraw::GLColorToSFML(color, 60));
@@ -117,3 +120,49 @@ void SFMLDebugDraw::DrawTransform(const b2Transform& xf)
 	m_window->draw(redLine, 2, sf::Lines);
 	m_window->draw(greenLine, 2, sf::Lines);
 }
+
+void SFMLDebugDraw::DrawFixture(const b2Fixture* fixture, const b2Color& color)
+{
+	const b2Transform& xf = fixture->GetBody()->GetTransform();
+	switch(fixture->GetType())
+	{
+	case b2Shape::e_circle:
+	{
+		const b2CircleShape* circle = static_cast<const b2CircleShape*>(fixture->GetShape());
+		b2Vec2 center = b2Mul(xf, circle->m_p);
+		b2Vec2 axis = b2Mul(xf.q, b2Vec2(1.0f, 0.0f));
+		DrawSolidCircle(center, circle->m_radius, axis, color);
+		break;
+	}
+	case b2Shape::e_edge:
+	{
+		const b2EdgeShape* edge = static_cast<const b2EdgeShape*>(fixture->GetShape());
+		DrawSegment(b2Mul(xf, edge->m_vertex1), b2Mul(xf, edge->m_vertex2), color);
+		break;
+	}
+	case b2Shape::e_chain:
+	{
+		const b2ChainShape* chain = static_cast<const b2ChainShape*>(fixture->GetShape());
+		b2Vec2 v1 = b2Mul(xf, chain->m_vertices[0]);
+		for(int32 i = 1; i < chain->m_count; ++i)
+		{
+			b2Vec2 v2 = b2Mul(xf, chain->m_vertices[i]);
+			DrawSegment(v1, v2, color);
+			v1 = v2;
+		}
+		break;
+	}
+	case b2Shape::e_polygon:
+	{
+		const b2PolygonShape* poly = static_cast<const b2PolygonShape*>(fixture->GetShape());
+		int32 vertexCount = poly->GetVertexCount();
+		b2Vec2 vertices[b2_maxPolygonVertices];
+		for(int32 i = 0; i < vertexCount; ++i)
+			vertices[i] = b2Mul(xf, poly->GetVertex(i));
+		DrawSolidPolygon(vertices, vertexCount, color);
+		break;
+	}
+	default:
+		break;
+	}
+}
@@ -15,7 +15,8 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 //[TehPwns] This is a modified version for SDL2D3. Notably, the use if conf::ppm, setWindow,
-//and the new DrawPoint function from Box2D
+//and the new DrawPoint function from Box2D. Any render target can be drawn to. DrawFixture
+//draws a single fixture, so callers can draw only what a broadphase query found
 
 #ifndef SFMLDEBUGDRAW_H
 #define SFMLDEBUGDRAW_H
@@ -34,9 +35,13 @@ namespace sfdd
 class SFMLDebugDraw : public b2Draw
 {
 private:
-    sf::RenderWindow* m_window = nullptr;
+    sf::RenderTarget* m_window = nullptr;
+
+    //Reused by every draw call, so drawing doesn't allocate once their buffers have grown
+    sf::ConvexShape m_polygon;
+    sf::CircleShape m_circle;
 public:
-    void setWindow(sf::RenderWindow& window) {
+    void setWindow(sf::RenderTarget& window) {
        m_window = &window;
     }
 
@@ -73,5 +78,8 @@ public:
 
 	/// Draw a transform. Choose your own length scale.
 	void DrawTransform(const b2Transform& xf);
+
+	/// Draw one fixture in world space, as b2World::DrawDebugData would.
+	void DrawFixture(const b2Fixture* fixture, const b2Color& color);
 };
 #endif //SFMLDEBUGDRAW_H
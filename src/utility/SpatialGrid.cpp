@@ -0,0 +1,40 @@
+#include <algorithm>
+#include "SpatialGrid.h"
+
+void SpatialGrid::clear()
+{
+    pending.clear();
+}
+
+void SpatialGrid::add(float x, float y, float radius, std::uint32_t value)
+{
+    pending.push_back(Item{x, y, radius, 0, 0, value});
+}
+
+void SpatialGrid::build()
+{
+    //Size the cells and the bucket table (about two buckets per object) for this set
+    maxRadius = 0;
+    for(const Item& item : pending)
+        maxRadius = std::max(maxRadius, item.radius);
+    float cellSize = (fixedCellSize > 0) ? fixedCellSize : std::max(2 * maxRadius, 1e-3f);
+    inverse = 1 / cellSize;
+    std::uint32_t buckets = 64;
+    while(buckets < pending.size() * 2)
+        buckets *= 2;
+    mask = buckets - 1;
+
+    //Counting sort by bucket: count, turn counts into starts, then place
+    starts.assign(buckets + 1, 0);
+    for(Item& item : pending) {
+        item.cx = std::floor(item.x * inverse);
+        item.cy = std::floor(item.y * inverse);
+        ++starts[bucket(item.cx, item.cy) + 1];
+    }
+    for(std::uint32_t b = 0; b != buckets; ++b)
+        starts[b + 1] += starts[b];
+    items.resize(pending.size());
+    cursor.assign(starts.begin(), starts.end() - 1);
+    for(const Item& item : pending)
+        items[cursor[bucket(item.cx, item.cy)]++] = item;
+}
@@ -0,0 +1,92 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/* A uniform grid over an unbounded plane, for many objects of about the same
+ * size. Each object is filed under the one cell holding its center, and cells
+ * are hashed into a power-of-two bucket table. Rather than being moved cell to
+ * cell, objects are re-added and the grid rebuilt with a counting sort, which
+ * is linear and leaves every bucket's objects next to each other in memory.
+ *
+ * Queries widen their box by the largest object radius, so a few outsized
+ * objects make every query visit more cells. Cells default to the size of the
+ * largest object. */
+
+class SpatialGrid
+{
+public:
+    //Start collecting objects for the next build
+    void clear();
+    void add(float x, float y, float radius, std::uint32_t value);
+    void build();
+
+    //Call f(value) for each object whose bounding box overlaps [left, right] x [top, bottom]
+    template <typename F>
+    void query(float left, float top, float right, float bottom, F f) const;
+
+    std::size_t size() const { return items.size(); }
+
+    //Fixed cell size; 0 (the default) sizes cells to the largest object at each build
+    void setCellSize(float size) { fixedCellSize = size; }
+
+private:
+    struct Item
+    {
+        float x, y, radius;
+        std::int32_t cx, cy;    //Cell, to tell apart cells that share a bucket
+        std::uint32_t value;
+    };
+
+    std::uint32_t bucket(std::int32_t cx, std::int32_t cy) const
+    {
+        return (std::uint32_t(cx) * 73856093u ^ std::uint32_t(cy) * 19349663u) & mask;
+    }
+
+    std::vector<Item> pending;          //Added since clear()
+    std::vector<Item> items;            //Sorted by bucket
+    std::vector<std::uint32_t> starts;  //Bucket b is items [starts[b], starts[b+1])
+    std::vector<std::uint32_t> cursor;  //Scratch for build()
+    float fixedCellSize = 0;
+    float inverse = 1;                  //1 / cell size
+    float maxRadius = 0;
+    std::uint32_t mask = 0;
+};
+
+template <typename F>
+void SpatialGrid::query(float left, float top, float right, float bottom, F f) const
+{
+    if(items.empty())
+        return;
+
+    //A box covering more cells than there are buckets is cheaper to answer by scanning
+    float cells = ((right - left) * inverse + 3) * ((bottom - top) * inverse + 3);
+    if(!(cells < starts.size())) {
+        for(const Item& item : items) {
+            if(item.x + item.radius >= left && item.x - item.radius <= right &&
+               item.y + item.radius >= top  && item.y - item.radius <= bottom)
+                f(item.value);
+        }
+        return;
+    }
+
+    std::int32_t x0 = std::floor((left - maxRadius) * inverse), x1 = std::floor((right + maxRadius) * inverse);
+    std::int32_t y0 = std::floor((top - maxRadius) * inverse), y1 = std::floor((bottom + maxRadius) * inverse);
+    for(std::int32_t cy = y0; cy <= y1; ++cy) {
+        for(std::int32_t cx = x0; cx <= x1; ++cx) {
+            std::uint32_t b = bucket(cx, cy);
+            for(std::uint32_t i = starts[b]; i != starts[b + 1]; ++i) {
+                const Item& item = items[i];
+                if(item.cx != cx || item.cy != cy)
+                    continue;
+                if(item.x + item.radius >= left && item.x - item.radius <= right &&
+                   item.y + item.radius >= top  && item.y - item.radius <= bottom)
+                    f(item.value);
+            }
+        }
+    }
+}
+
+#endif // SPATIALGRID_H
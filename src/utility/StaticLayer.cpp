@@ -0,0 +1,25 @@
+#include "StaticLayer.h"
+
+void StaticLayer::create(const sf::RenderTarget& target)
+{
+    //Match a window's antialiasing so cached edges look like those drawn directly
+    sf::ContextSettings settings;
+    if(const sf::Window* window = dynamic_cast<const sf::Window*>(&target))
+        settings.antialiasingLevel = window->getSettings().antialiasingLevel;
+    texture.create(target.getSize().x, target.getSize().y, settings);
+}
+
+bool StaticLayer::changed(const sf::View& view) const
+{
+    return view.getCenter() != cachedView.getCenter() || view.getSize() != cachedView.getSize() ||
+           view.getRotation() != cachedView.getRotation() || view.getViewport() != cachedView.getViewport();
+}
+
+void StaticLayer::blit(sf::RenderTarget& target) const
+{
+    //The texture already holds the view's transform, so draw it 1:1 over the target
+    sf::View view = target.getView();
+    target.setView(target.getDefaultView());
+    target.draw(sf::Sprite(texture.getTexture()), sf::BlendMode(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha));
+    target.setView(view);
+}
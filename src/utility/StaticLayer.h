@@ -0,0 +1,51 @@
+#ifndef STATICLAYER_H
+#define STATICLAYER_H
+
+#include <SFML/Graphics.hpp>
+
+/* Caches content that only changes with the view in an off-screen texture.
+ * draw() re-renders through the given callback when the view, zoom or target
+ * size changed since the last render (or after invalidate()), and otherwise
+ * just blits the cached texture with a single quad.
+ *
+ * Content drawn with sf::BlendAlpha over the transparent texture ends up with
+ * premultiplied alpha (SFML blends the alpha channel with One, OneMinusSrcAlpha),
+ * so the blit uses the premultiplied blend; BlendAlpha again would apply
+ * translucent content's alpha twice. */
+
+class StaticLayer
+{
+public:
+    //Force a re-render on the next draw, for when the content itself changed
+    void invalidate() { valid = false; }
+
+    //Draw the layer to `target` with its current view. `render(sf::RenderTarget&)` draws
+    //the layer's content in world coordinates, and is only called when the cache is stale
+    template<typename F>
+    void draw(sf::RenderTarget& target, F&& render)
+    {
+        const sf::View& view = target.getView();
+        if(!valid || target.getSize() != texture.getSize() || changed(view)) {
+            if(target.getSize() != texture.getSize())
+                create(target);
+            texture.setView(view);
+            texture.clear(sf::Color::Transparent);
+            render(static_cast<sf::RenderTarget&>(texture));
+            texture.display();
+            cachedView = view;
+            valid = true;
+        }
+        blit(target);
+    }
+
+private:
+    void create(const sf::RenderTarget& target);
+    bool changed(const sf::View& view) const;
+    void blit(sf::RenderTarget& target) const;
+
+    sf::RenderTexture texture;
+    sf::View cachedView;
+    bool valid = false;
+};
+
+#endif // STATICLAYER_H
@@ -0,0 +1,238 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sys/stat.h>
+#include "config.h"
+
+namespace {
+
+struct KeyInfo
+{
+    const char* name;
+    Config::Type type;
+    const char* def;
+    float min, max;
+};
+
+const KeyInfo keyInfo[cfg::KEY_COUNT] = {
+#define SDL2D3_CONFIG_INFO(name, type, def, min, max) {#name, Config::type, def, min, max},
+    SDL2D3_CONFIG_KEYS(SDL2D3_CONFIG_INFO)
+#undef SDL2D3_CONFIG_INFO
+};
+
+std::time_t modificationTime(const std::string& path)
+{
+    struct stat info;
+    return (stat(path.c_str(), &info) == 0) ? info.st_mtime : 0;
+}
+
+//Trim spaces and tabs from both ends of [begin, end)
+void trim(const char*& begin, const char*& end)
+{
+    while(begin != end && (*begin == ' ' || *begin == '\t'))
+        ++begin;
+    while(end != begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        --end;
+}
+
+}
+
+Config::Config()
+    : values(defaults())
+    , modified(0)
+{
+}
+
+const char* Config::name(cfg::Key key)
+{
+    return keyInfo[key].name;
+}
+
+Config::Type Config::type(cfg::Key key)
+{
+    return keyInfo[key].type;
+}
+
+float Config::minimum(cfg::Key key)
+{
+    return keyInfo[key].min;
+}
+
+float Config::maximum(cfg::Key key)
+{
+    return keyInfo[key].max;
+}
+
+bool Config::find(const std::string& name, cfg::Key& key)
+{
+    for(int i = 0; i != cfg::KEY_COUNT; ++i) {
+        if(name == keyInfo[i].name) {
+            key = static_cast<cfg::Key>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+Config::Values Config::defaults()
+{
+    Values result;
+    for(int i = 0; i != cfg::KEY_COUNT; ++i) {
+        cfg::Key key = static_cast<cfg::Key>(i);
+        const char* def = keyInfo[i].def;
+        parse(key, def, def + std::strlen(def), result[i]);
+    }
+    return result;
+}
+
+bool Config::parse(cfg::Key key, const char* begin, const char* end, Value& out)
+{
+    const KeyInfo& info = keyInfo[key];
+    Value v;
+    v.text.assign(begin, end);
+    v.number = 0;
+    v.real = 0;
+
+    const char* s = v.text.c_str();
+    char* parsedEnd = nullptr;
+    switch(info.type)
+    {
+    case Int:
+        v.number = std::strtol(s, &parsedEnd, 10);
+        v.real = v.number;
+        break;
+    case Float:
+        v.real = std::strtof(s, &parsedEnd);
+        break;
+    case Bool:
+        if(v.text == "1" || v.text == "true" || v.text == "yes" || v.text == "on") {
+            v.number = 1;
+        } else if(!(v.text == "0" || v.text == "false" || v.text == "no" || v.text == "off")) {
+            return false;
+        }
+        break;
+    case String:
+        break;
+    }
+
+    //Numbers must consume the whole value and lie in the declared range
+    if(info.type == Int || info.type == Float) {
+        if(parsedEnd == s || *parsedEnd != '\0')
+            return false;
+        if(info.min != info.max && (v.real < info.min || v.real > info.max))
+            return false;
+    }
+
+    out = std::move(v);
+    return true;
+}
+
+bool Config::parseFile(const std::string& path, Values& out)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open())
+        return false;
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    //Walk the file a line at a time without copying lines out
+    const char* pos = contents.data();
+    const char* fileEnd = pos + contents.size();
+    int lineNo = 0;
+    while(pos < fileEnd)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(pos, '\n', fileEnd - pos));
+        if(lineEnd == nullptr)
+            lineEnd = fileEnd;
+        const char* begin = pos;
+        const char* end = static_cast<const char*>(std::memchr(pos, ';', lineEnd - pos));
+        if(end == nullptr)
+            end = lineEnd;
+        pos = lineEnd + 1;
+        ++lineNo;
+
+        trim(begin, end);
+        if(begin == end)
+            continue;
+        const char* equals = static_cast<const char*>(std::memchr(begin, '=', end - begin));
+        if(equals == nullptr) {
+            std::cerr << "Config: " << path << ":" << lineNo << ": expected key=value" << std::endl;
+            continue;
+        }
+        const char* keyEnd = equals;
+        const char* valueBegin = equals + 1;
+        trim(begin, keyEnd);
+        trim(valueBegin, end);
+
+        //Key lookup is a linear scan, but it only happens while loading
+        std::size_t keyLength = keyEnd - begin;
+        int index = 0;
+        while(index != cfg::KEY_COUNT && (std::strlen(keyInfo[index].name) != keyLength ||
+                                          std::strncmp(keyInfo[index].name, begin, keyLength) != 0))
+            ++index;
+        if(index == cfg::KEY_COUNT) {
+            std::cerr << "Config: " << path << ":" << lineNo << ": unknown key "
+                      << std::string(begin, keyEnd) << std::endl;
+            continue;
+        }
+
+        cfg::Key key = static_cast<cfg::Key>(index);
+        if(!parse(key, valueBegin, end, out[index])) {
+            std::cerr << "Config: " << path << ":" << lineNo << ": invalid value for " << name(key)
+                      << ", using " << out[index].text << std::endl;
+        }
+    }
+    return true;
+}
+
+bool Config::same(cfg::Key key, const Value& a, const Value& b)
+{
+    switch(type(key))
+    {
+    case Int:
+    case Bool:
+        return a.number == b.number;
+    case Float:
+        return a.real == b.real;
+    default:
+        return a.text == b.text;
+    }
+}
+
+bool Config::load(const std::string& filename)
+{
+    path = filename;
+    modified = modificationTime(path);
+    values = defaults();
+    if(!parseFile(path, values)) {
+        std::cerr << "Config: File " << path << " couldn't be found!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Config::set(cfg::Key key, const std::string& value)
+{
+    return parse(key, value.data(), value.data() + value.size(), values[key]);
+}
+
+Config::KeySet Config::reloadIfChanged()
+{
+    KeySet changed;
+    std::time_t now = modificationTime(path);
+    if(now == modified)
+        return changed;
+    modified = now;
+
+    //Keys removed from the file go back to their defaults
+    Values fresh = defaults();
+    if(!parseFile(path, fresh))
+        return changed;
+    for(int i = 0; i != cfg::KEY_COUNT; ++i) {
+        if(!same(static_cast<cfg::Key>(i), values[i], fresh[i]))
+            changed.set(i);
+    }
+    values = std::move(fresh);
+    return changed;
+}
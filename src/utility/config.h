@@ -0,0 +1,138 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <array>
+#include <bitset>
+#include <ctime>
+#include <string>
+
+/* Every key the config file understands, declared once:
+ *   X(name, type, default, min, max)
+ * min/max validate Int and Float keys (ignored when min == max). Adding a
+ * key here is all that's needed to read it with config.getX(cfg::NAME). */
+#define SDL2D3_CONFIG_KEYS(X) \
+    X(WIDTH,                     Int,    "1200", 1, 16384) \
+    X(HEIGHT,                    Int,    "900",  1, 16384) \
+    X(ICON_TEXTURE,              String, "data/icon.png", 0, 0) \
+    X(CONFIG_HOT_RELOAD,         Bool,   "1",    0, 0) \
+    X(GUI_PARAM_INTERVAL_MS,     Int,    "50",   0, 10000) \
+    X(BOX2D_VELOCITY_ITERATIONS, Int,    "8",    1, 100) \
+    X(BOX2D_POSITION_ITERATIONS, Int,    "5",    1, 100) \
+    X(BOX2D_SUBSTEPS,            Int,    "1",    1, 16) \
+    X(BOX2D_WARM_STARTING,       Bool,   "1",    0, 0) \
+    X(BOX2D_CONTINUOUS,          Bool,   "1",    0, 0) \
+    X(BOX2D_DENSITY,             Float,  "1.0",  0.01, 100) \
+    X(BOX2D_RESTITUTION,         Float,  "0.3",  0, 1) \
+    X(BOX2D_CIRCLE_RESTITUTION,  Float,  "1.0",  0, 1) \
+    X(LIGHT_OVER_SHADER,         String, "data/lightOverShapeShader", 0, 0) \
+    X(LIGHT_UNSHADOW_SHADER,     String, "data/unshadowShader", 0, 0) \
+    X(LIGHT_PRENUMBRA_TEXTURE,   String, "data/penumbraTexture.png", 0, 0) \
+    X(LIGHT_POINT_TEXTURE,       String, "data/pointLightTexture.png", 0, 0) \
+    X(BOX_TEXTURES,              String, "data/wood_crate_03.bmp", 0, 0) \
+    X(BALL_TEXTURES,             String, "data/bouncy_ball.png", 0, 0) \
+    X(BACKGROUND_TEXTURE,        String, "data/noise.png", 0, 0) \
+    X(OBJECT_FONT,               String, "data/sansation.ttf", 0, 0) \
+    X(SHAPE_FILES,               String, "", 0, 0) \
+    X(SHAPE_TEXTURES,            String, "data/wood_01_b.jpg", 0, 0) \
+    X(LEVEL_FILE,                String, "", 0, 0) \
+    X(LEVEL_TILE_SIZE,           Float,  "30",   4, 512) \
+    X(LEVEL_TEXTURE,             String, "data/wood_crate_10.jpg", 0, 0) \
+    X(OFFSCREEN,                 Bool,   "0",    0, 0) \
+    X(OFFSCREEN_FRAMES,          Int,    "600",  0, 10000000) \
+    X(OFFSCREEN_DUMP_EVERY,      Int,    "60",   0, 10000000) \
+    X(OFFSCREEN_DUMP_DIR,        String, "frames", 0, 0) \
+    X(OFFSCREEN_SPAWN,           Int,    "200",  0, 100000) \
+    X(PHYSICS_METRICS_FILE,      String, "", 0, 0) \
+    X(TRACE_ENABLED,             Bool,   "0",    0, 0) \
+    X(TRACE_FILE,                String, "trace.json", 0, 0) \
+    X(GOVERNOR_ENABLED,          Bool,   "1",    0, 0) \
+    X(GOVERNOR_BUDGET_MS,        Float,  "14",   1, 1000) \
+    X(GOVERNOR_RESTORE_RATIO,    Float,  "0.6",  0.1, 1) \
+    X(GOVERNOR_FRAMES,           Int,    "30",   1, 1000) \
+    X(JOB_THREADS,               Int,    "0",    0, 64) \
+    X(CONTACT_BUFFER,            Int,    "8192", 16, 1000000) \
+    X(CONTACT_IMPULSE_MIN,       Float,  "0.5",  0, 1000) \
+    X(BROADPHASE,                String, "tree", 0, 0) \
+    X(PARTICLE_MAX,              Int,    "100000", 0, 10000000) \
+    X(PARTICLE_LIFETIME,         Float,  "3",    0.1, 60) \
+    X(PARTICLE_BURST,            Int,    "2000", 1, 1000000) \
+    X(PARTICLE_LIGHTS,           Int,    "16",   0, 256) \
+    X(PARTICLE_IMPACT_SPARKS,    Int,    "8",    0, 1000) \
+    X(TIME_SCALE,                Float,  "1",    0.05, 64) \
+    X(TIME_RENDER_SKIP,          Int,    "0",    0, 600) \
+    X(TIME_MAX_STEPS,            Int,    "8",    1, 1000) \
+    X(HISTORY_ENABLED,           Bool,   "1",    0, 0) \
+    X(HISTORY_MEMORY_MB,         Float,  "64",   1, 4096) \
+    X(HISTORY_RATE,              Int,    "30",   1, 240) \
+    X(HISTORY_POSITION_PRECISION, Float, "0.001", 0.00001, 1) \
+    X(HISTORY_ANGLE_PRECISION,   Float,  "0.001", 0.00001, 1) \
+    X(HISTORY_VELOCITY_PRECISION, Float, "0.01", 0.00001, 10)
+
+namespace cfg {
+
+enum Key {
+#define SDL2D3_CONFIG_ENUM(name, type, def, min, max) name,
+    SDL2D3_CONFIG_KEYS(SDL2D3_CONFIG_ENUM)
+#undef SDL2D3_CONFIG_ENUM
+    KEY_COUNT
+};
+
+}
+
+/* Typed configuration store. The file is parsed and validated once on load;
+ * lookups are then a plain array index. Invalid or missing values fall back
+ * to their declared default with a message on stderr. */
+
+class Config
+{
+public:
+    enum Type { Int, Float, Bool, String };
+    typedef std::bitset<cfg::KEY_COUNT> KeySet;
+
+    //Starts with every key at its default
+    Config();
+
+    //Parse a key=value file (; starts a comment). Returns false if it couldn't be read
+    bool load(const std::string& path);
+
+    //Re-parse the loaded file if it was modified since. Returns the keys whose value changed
+    KeySet reloadIfChanged();
+
+    //Override one key, validated as if read from the file. False (and unchanged) if invalid
+    bool set(cfg::Key key, const std::string& value);
+
+    int   getInt(cfg::Key key) const   { return values[key].number; }
+    float getFloat(cfg::Key key) const { return values[key].real; }
+    bool  getBool(cfg::Key key) const  { return values[key].number != 0; }
+    const std::string& getString(cfg::Key key) const { return values[key].text; }
+
+    static const char* name(cfg::Key key);
+    static Type type(cfg::Key key);
+
+    //Declared range of an Int or Float key; both equal when it isn't checked
+    static float minimum(cfg::Key key);
+    static float maximum(cfg::Key key);
+
+    //Key by its name in the file. False if there is no such key
+    static bool find(const std::string& name, cfg::Key& key);
+
+private:
+    struct Value
+    {
+        int number;         //Int and Bool
+        float real;         //Float; also set for Int
+        std::string text;   //Raw text for every type
+    };
+    typedef std::array<Value, cfg::KEY_COUNT> Values;
+
+    static Values defaults();
+    static bool parse(cfg::Key key, const char* begin, const char* end, Value& out);
+    static bool parseFile(const std::string& path, Values& out);
+    static bool same(cfg::Key key, const Value& a, const Value& b);
+
+    Values values;
+    std::string path;
+    std::time_t modified;
+};
+
+#endif // CONFIG_H
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cmath>
+#include "decompose.h"
+
+namespace {
+
+typedef std::vector<std::size_t> Piece;   //Indices into the cleaned polygon
+
+float cross(const sf::Vector2f& a, const sf::Vector2f& b, const sf::Vector2f& c)
+{
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+bool insideTriangle(const sf::Vector2f& p, const sf::Vector2f& a, const sf::Vector2f& b, const sf::Vector2f& c)
+{
+    return cross(a, b, p) >= 0 && cross(b, c, p) >= 0 && cross(c, a, p) >= 0;
+}
+
+bool isConvex(const Polygon& points, const Piece& piece)
+{
+    std::size_t n = piece.size();
+    for(std::size_t i = 0; i != n; ++i) {
+        const sf::Vector2f& a = points[piece[i]];
+        const sf::Vector2f& b = points[piece[(i + 1) % n]];
+        const sf::Vector2f& c = points[piece[(i + 2) % n]];
+        if(cross(a, b, c) < 0)
+            return false;
+    }
+    return true;
+}
+
+bool onSegment(const sf::Vector2f& p, const sf::Vector2f& a, const sf::Vector2f& b)
+{
+    return std::min(a.x, b.x) <= p.x && p.x <= std::max(a.x, b.x) &&
+           std::min(a.y, b.y) <= p.y && p.y <= std::max(a.y, b.y);
+}
+
+//Whether segments ab and cd cross or touch
+bool segmentsMeet(const sf::Vector2f& a, const sf::Vector2f& b, const sf::Vector2f& c, const sf::Vector2f& d)
+{
+    float abc = cross(a, b, c), abd = cross(a, b, d), cda = cross(c, d, a), cdb = cross(c, d, b);
+    if(((abc > 0 && abd < 0) || (abc < 0 && abd > 0)) && ((cda > 0 && cdb < 0) || (cda < 0 && cdb > 0)))
+        return true;
+    return (abc == 0 && onSegment(c, a, b)) || (abd == 0 && onSegment(d, a, b)) ||
+           (cda == 0 && onSegment(a, c, d)) || (cdb == 0 && onSegment(b, c, d));
+}
+
+//A polygon is simple when no two edges meet, other than neighbours at their shared point
+bool isSimple(const Polygon& points)
+{
+    std::size_t n = points.size();
+    for(std::size_t i = 0; i != n; ++i) {
+        for(std::size_t j = i + 2; j < n; ++j) {
+            if(i == 0 && j == n - 1)
+                continue;
+            if(segmentsMeet(points[i], points[i + 1], points[j], points[(j + 1) % n]))
+                return false;
+        }
+    }
+    return true;
+}
+
+//Remove repeated and collinear points, and make the winding counter-clockwise
+Polygon clean(const Polygon& polygon)
+{
+    Polygon points;
+    for(const sf::Vector2f& p : polygon) {
+        if(points.empty() || p != points.back())
+            points.push_back(p);
+    }
+    while(points.size() > 1 && points.front() == points.back())
+        points.pop_back();
+
+    bool removed = true;
+    while(removed && points.size() >= 3) {
+        removed = false;
+        for(std::size_t i = 0; i != points.size(); ++i) {
+            std::size_t n = points.size();
+            if(cross(points[(i + n - 1) % n], points[i], points[(i + 1) % n]) == 0) {
+                points.erase(points.begin() + i);
+                removed = true;
+                break;
+            }
+        }
+    }
+
+    if(polygonArea(points) < 0)
+        std::reverse(points.begin(), points.end());
+    return points;
+}
+
+//Ear clipping; O(n^3) worst case, which is fine for assets decomposed once.
+//False if an ear can't be found, which means the polygon isn't simple
+bool triangulate(const Polygon& points, std::vector<Piece>& triangles)
+{
+    Piece remaining(points.size());
+    for(std::size_t i = 0; i != remaining.size(); ++i)
+        remaining[i] = i;
+
+    while(remaining.size() > 3) {
+        std::size_t n = remaining.size();
+        bool clipped = false;
+        for(std::size_t i = 0; i != n && !clipped; ++i) {
+            std::size_t prev = remaining[(i + n - 1) % n], cur = remaining[i], next = remaining[(i + 1) % n];
+            const sf::Vector2f &a = points[prev], &b = points[cur], &c = points[next];
+            if(cross(a, b, c) <= 0)
+                continue;
+            bool ear = true;
+            for(std::size_t other : remaining) {
+                if(other != prev && other != cur && other != next && insideTriangle(points[other], a, b, c)) {
+                    ear = false;
+                    break;
+                }
+            }
+            if(ear) {
+                triangles.push_back({prev, cur, next});
+                remaining.erase(remaining.begin() + i);
+                clipped = true;
+            }
+        }
+        if(!clipped)
+            return false;
+    }
+    if(remaining.size() == 3)
+        triangles.push_back(remaining);
+    return true;
+}
+
+//Merge `b` into `a` if they share an edge and the union is convex and small enough
+bool tryMerge(const Polygon& points, Piece& a, const Piece& b, std::size_t maxVertices)
+{
+    if(a.size() + b.size() - 2 > maxVertices)
+        return false;
+    std::size_t na = a.size(), nb = b.size();
+    for(std::size_t i = 0; i != na; ++i) {
+        for(std::size_t j = 0; j != nb; ++j) {
+            //Shared edge a[i]->a[i+1] is b[j]->b[j+1] reversed
+            if(a[i] != b[(j + 1) % nb] || a[(i + 1) % na] != b[j])
+                continue;
+            Piece merged;
+            for(std::size_t k = 0; k != na; ++k)
+                merged.push_back(a[(i + 1 + k) % na]);
+            for(std::size_t k = 2; k != nb; ++k)
+                merged.push_back(b[(j + k) % nb]);
+            if(!isConvex(points, merged))
+                return false;
+            a = std::move(merged);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+float polygonArea(const Polygon& polygon)
+{
+    float area = 0;
+    for(std::size_t i = 0, n = polygon.size(); i != n; ++i) {
+        const sf::Vector2f& p = polygon[i];
+        const sf::Vector2f& q = polygon[(i + 1) % n];
+        area += p.x * q.y - q.x * p.y;
+    }
+    return area / 2;
+}
+
+bool decomposeConvex(const Polygon& polygon, std::size_t maxVertices, std::vector<Polygon>& result)
+{
+    Polygon points = clean(polygon);
+    result.clear();
+    if(points.size() < 3)
+        return true;
+    if(!isSimple(points))
+        return false;
+
+    //Triangulate, then merge neighbours until nothing else can be merged
+    std::vector<Piece> pieces;
+    if(!triangulate(points, pieces))
+        return false;
+    bool merged = true;
+    while(merged) {
+        merged = false;
+        for(std::size_t i = 0; i != pieces.size() && !merged; ++i) {
+            for(std::size_t j = i + 1; j != pieces.size() && !merged; ++j) {
+                if(tryMerge(points, pieces[i], pieces[j], maxVertices)) {
+                    pieces.erase(pieces.begin() + j);
+                    merged = true;
+                }
+            }
+        }
+    }
+
+    for(const Piece& piece : pieces) {
+        Polygon convex;
+        for(std::size_t index : piece)
+            convex.push_back(points[index]);
+        if(std::abs(polygonArea(convex)) > 1e-3f)
+            result.push_back(std::move(convex));
+    }
+    return true;
+}
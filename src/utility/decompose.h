@@ -0,0 +1,22 @@
+#ifndef DECOMPOSE_H
+#define DECOMPOSE_H
+
+#include <vector>
+#include <SFML/System/Vector2.hpp>
+
+/* Convex decomposition of simple polygons, for physics engines that only
+ * accept convex shapes with a bounded vertex count. The polygon is ear-clipped
+ * into triangles, which are then greedily merged back together across shared
+ * edges (Hertel-Mehlhorn) while the result stays convex and small enough. */
+
+typedef std::vector<sf::Vector2f> Polygon;
+
+//Signed area of a polygon; positive for counter-clockwise in a y-up frame
+float polygonArea(const Polygon& polygon);
+
+//Split a simple polygon of either winding into convex `pieces` of at most
+//`maxVertices` each, all counter-clockwise. Pieces with negligible area are dropped.
+//False, with no pieces, if the polygon isn't simple
+bool decomposeConvex(const Polygon& polygon, std::size_t maxVertices, std::vector<Polygon>& pieces);
+
+#endif // DECOMPOSE_H
@@ -0,0 +1,21 @@
+#ifndef STRINGS_H
+#define STRINGS_H
+
+#include <string>
+#include <vector>
+
+//General-porpose string split function
+inline std::vector<std::string> strSplit(const std::string& target, const std::string& delim)
+{
+    std::vector<std::string> result;
+    size_t startPos = 0, it = 0;
+    do {
+        it = target.find(delim, startPos);
+        result.push_back(target.substr(startPos, it - startPos));
+        startPos = it + delim.length();
+    }
+    while(it != std::string::npos);
+    return result;
+}
+
+#endif // STRINGS_H
@@ -0,0 +1,103 @@
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "trace.h"
+
+namespace trace {
+
+std::atomic<bool> active(false);
+
+}
+
+namespace {
+
+struct Event
+{
+    const char* name;
+    std::int64_t start;
+    std::int64_t duration;
+};
+
+/* One per thread, only written by that thread. `written` publishes events to write().
+ * The ring is only allocated by the thread's first event, so threads that are
+ * named but never traced (every worker, with tracing off) cost a few bytes */
+struct ThreadBuffer
+{
+    static constexpr std::size_t capacity = 1 << 16;
+    std::unique_ptr<Event[]> events;
+    std::atomic<std::uint64_t> written {0};
+    std::string name;
+    int id;
+};
+
+//Buffers outlive their threads, so events from finished threads are still written
+std::mutex registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;
+
+ThreadBuffer& localBuffer()
+{
+    thread_local ThreadBuffer* buffer = [] {
+        auto created = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        created->id = registry.size() + 1;
+        created->name = "Thread " + std::to_string(created->id);
+        registry.push_back(created);
+        return created.get();
+    }();
+    return *buffer;
+}
+
+}
+
+namespace trace {
+
+void setEnabled(bool enabled)
+{
+    active.store(enabled, std::memory_order_relaxed);
+}
+
+void record(const char* name, std::int64_t start, std::int64_t duration)
+{
+    ThreadBuffer& buffer = localBuffer();
+    if(!buffer.events)
+        buffer.events.reset(new Event[ThreadBuffer::capacity]);
+    std::uint64_t n = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[n % ThreadBuffer::capacity] = Event{name, start, duration};
+    buffer.written.store(n + 1, std::memory_order_release);
+}
+
+void setThreadName(const char* name)
+{
+    ThreadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer.name = name;
+}
+
+bool write(const std::string& path)
+{
+    std::ofstream file(path);
+    if(!file.is_open())
+        return false;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    for(const auto& buffer : registry) {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+             << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+        first = false;
+
+        std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+        std::uint64_t begin = written > ThreadBuffer::capacity ? written - ThreadBuffer::capacity : 0;
+        for(std::uint64_t i = begin; i != written; ++i) {
+            const Event& e = buffer->events[i % ThreadBuffer::capacity];
+            file << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                 << ",\"ts\":" << e.start << ",\"dur\":" << e.duration << "}";
+        }
+    }
+    file << "\n]}\n";
+    return file.good();
+}
+
+}
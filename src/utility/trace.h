@@ -0,0 +1,71 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/* Lightweight timeline tracing, written out as Chrome trace-event JSON (open
+ * in chrome://tracing or ui.perfetto.dev). TRACE_SCOPE("name") records how long
+ * the enclosing scope took into a fixed-size buffer owned by the calling
+ * thread; no locks are taken while recording, and a disabled tracer costs one
+ * atomic load per scope. Each thread keeps its most recent events only.
+ *
+ * Names must be string literals (or otherwise outlive the trace). write() is
+ * meant for quiet points such as between frames; a thread still recording
+ * during a write can leave a torn event in its own buffer. */
+
+namespace trace {
+
+extern std::atomic<bool> active;    //Use enabled() and setEnabled()
+
+void setEnabled(bool enabled);
+
+inline bool enabled()
+{
+    return active.load(std::memory_order_relaxed);
+}
+
+//Microseconds on the trace clock
+inline std::int64_t now()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//Add a finished event to this thread's buffer
+void record(const char* name, std::int64_t start, std::int64_t duration);
+
+//Name this thread in the written trace
+void setThreadName(const char* name);
+
+//Write every thread's buffered events to `path`. Returns false if it couldn't be written
+bool write(const std::string& path);
+
+class Scope
+{
+public:
+    explicit Scope(const char* name)
+        : name(enabled() ? name : nullptr)
+        , start(this->name ? now() : 0)
+    { }
+    ~Scope()
+    {
+        if(name)
+            record(name, start, now() - start);
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+private:
+    const char* name;
+    std::int64_t start;
+};
+
+}
+
+#define SDL2D3_TRACE_CONCAT2(a, b) a##b
+#define SDL2D3_TRACE_CONCAT(a, b) SDL2D3_TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) trace::Scope SDL2D3_TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif // TRACE_H
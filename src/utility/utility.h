@@ -14,12 +14,21 @@ static constexpr float circle_radius = 30.f * mpp;  //Radius of spawned circles
 }
 
 //Convert a pixels value to meters
-float meters(int pixels);
+constexpr float meters(float pixels)
+{
+    return pixels * conf::mpp;
+}
 
 //Do the oppsite
-float pixels(long double meters);
+constexpr float pixels(float meters)
+{
+    return meters * conf::ppm;
+}
 
-//Allows literals like 10px, which convert to the meter value
-float operator"" _px(unsigned long long int _pixels);
+//Allows literals like 10_px, which convert to the meter value
+constexpr float operator"" _px(unsigned long long int _pixels)
+{
+    return meters(_pixels);
+}
 
 #endif // UTILITY_H
@@ -0,0 +1,51 @@
+#ifndef SDL2D3_VIEW_H
+#define SDL2D3_VIEW_H
+#include <cmath>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/View.hpp>
+
+//World rectangle covered by a view, for culling. Rotated views get their bounding box
+inline sf::FloatRect viewBounds(const sf::View& view)
+{
+    sf::Vector2f size = view.getSize();
+    sf::Vector2f center = view.getCenter();
+    if(view.getRotation() != 0) {
+        float r = std::sqrt(size.x * size.x + size.y * size.y);
+        size = {r, r};
+    }
+    return {center.x - size.x / 2, center.y - size.y / 2, size.x, size.y};
+}
+
+//Whether anything within `radius` of `center` can be inside `rect`
+inline bool inBounds(const sf::FloatRect& rect, const sf::Vector2f& center, float radius)
+{
+    return center.x + radius >= rect.left && center.x - radius <= rect.left + rect.width &&
+           center.y + radius >= rect.top  && center.y - radius <= rect.top + rect.height;
+}
+
+/* Same mapping as RenderTarget::mapPixelToCoords() for the current view. That
+ * one updates the view's cached inverse transform, so job threads use this,
+ * made once on the main thread, instead */
+class PixelMapper
+{
+public:
+    explicit PixelMapper(const sf::RenderTarget& target)
+        : toWorld(target.getView().getInverseTransform())
+        , viewport(target.getViewport(target.getView()))
+    {
+    }
+
+    sf::Vector2f operator()(const sf::Vector2i& pixel) const
+    {
+        sf::Vector2f normalized(-1.f + 2.f * (pixel.x - viewport.left) / viewport.width,
+                                 1.f - 2.f * (pixel.y - viewport.top) / viewport.height);
+        return toWorld.transformPoint(normalized);
+    }
+
+private:
+    sf::Transform toWorld;
+    sf::IntRect viewport;
+};
+
+#endif // SDL2D3_VIEW_H